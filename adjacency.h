@@ -0,0 +1,98 @@
+//
+// Created by juan-diego on 3/29/24.
+//
+
+#ifndef HOMEWORK_GRAPH_ADJACENCY_H
+#define HOMEWORK_GRAPH_ADJACENCY_H
+
+#include "edge.h"
+#include <cstdint>
+#include <vector>
+
+
+// *
+// ---- Arc ----
+// Un arco dirigido de la adyacencia compacta. Una arista con 'one_way' falso genera dos arcos.
+//
+// Variables miembro
+//     - to            : 'Node::index' del otro extremo del arco
+//     - edge          : 'Edge::index' de la arista que genero el arco
+//     - length        : Costo del arco ('Edge::length')
+// *
+struct Arc {
+    std::uint32_t to;
+    std::uint32_t edge;
+    double length;
+};
+
+
+// *
+// ---- Adjacency ----
+// Adyacencia en formato CSR indexada por 'Node::index': los arcos que salen del nodo u son
+// arcs[offsets[u]] .. arcs[offsets[u + 1] - 1]. Se usa en los preprocesamientos (arc flags, componentes, etc.),
+// que recorren el grafo muchas veces y se benefician de tener los arcos contiguos en memoria.
+// La posicion de un arco dentro de 'arcs' sirve como su identificador.
+//
+// Funciones miembro
+//     - forward       : Arcos u -> v tal como se pueden recorrer
+//     - backward      : Arcos invertidos: en la lista de v aparece u por cada arco u -> v
+//     - begin / end   : Rango de arcos del nodo u
+// *
+struct Adjacency {
+    std::vector<std::uint32_t> offsets;
+    std::vector<Arc> arcs;
+
+    static Adjacency forward(std::size_t node_count, const std::vector<Edge *> &edges) {
+        return build(node_count, edges, false);
+    }
+
+    static Adjacency backward(std::size_t node_count, const std::vector<Edge *> &edges) {
+        return build(node_count, edges, true);
+    }
+
+    const Arc *begin(std::size_t u) const {
+        return arcs.data() + offsets[u];
+    }
+
+    const Arc *end(std::size_t u) const {
+        return arcs.data() + offsets[u + 1];
+    }
+
+    std::size_t node_count() const {
+        return offsets.empty() ? 0 : offsets.size() - 1;
+    }
+
+private:
+    static Adjacency build(std::size_t node_count, const std::vector<Edge *> &edges, bool reversed) {
+        Adjacency adjacency;
+        adjacency.offsets.assign(node_count + 1, 0);
+
+        // cada arco como (cola, cabeza) en el sentido en que se recorre
+        auto for_each_arc = [&edges, reversed](auto &&visit) {
+            for (Edge *edge: edges) {
+                auto a = static_cast<std::uint32_t>(edge->src->index);
+                auto b = static_cast<std::uint32_t>(edge->dest->index);
+                if (reversed) std::swap(a, b);
+                visit(a, b, edge);
+                if (!edge->one_way) visit(b, a, edge);
+            }
+        };
+
+        for_each_arc([&](std::uint32_t from, std::uint32_t, Edge *) {
+            adjacency.offsets[from + 1]++;
+        });
+        for (std::size_t u = 0; u < node_count; ++u) {
+            adjacency.offsets[u + 1] += adjacency.offsets[u];
+        }
+
+        adjacency.arcs.resize(adjacency.offsets[node_count]);
+        std::vector<std::uint32_t> cursor(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+        for_each_arc([&](std::uint32_t from, std::uint32_t to, Edge *edge) {
+            adjacency.arcs[cursor[from]++] = {to, static_cast<std::uint32_t>(edge->index), edge->length};
+        });
+        return adjacency;
+    }
+};
+
+
+#endif //HOMEWORK_GRAPH_ADJACENCY_H
@@ -0,0 +1,276 @@
+//
+// Created by juan-diego on 3/29/24.
+//
+
+#ifndef HOMEWORK_GRAPH_ALTERNATIVE_ROUTES_H
+#define HOMEWORK_GRAPH_ALTERNATIVE_ROUTES_H
+
+#include "graph.h"
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <queue>
+#include <vector>
+
+
+// Parametros de 'AlternativeRoutes::compute'
+//     - k             : Cantidad maxima de rutas, incluyendo la optima
+//     - max_stretch   : Una alternativa puede medir a lo mas max_stretch * optimo
+//     - max_sharing   : Fraccion maxima del optimo que una alternativa puede compartir con cada ruta ya elegida
+//     - min_plateau   : Longitud minima de la meseta, como fraccion del optimo. Garantiza que la alternativa es
+//                       localmente optima: cualquier tramo de hasta min_plateau * optimo es un camino minimo
+struct AlternativeRouteOptions {
+    std::size_t k = 3;
+    double max_stretch = 1.25;
+    double max_sharing = 0.6;
+    double min_plateau = 0.1;
+};
+
+
+// *
+// ---- AlternativeRoute ----
+// Una ruta de 'src' a 'dest' como secuencia de nodos y aristas. La devuelve 'AlternativeRoutes::compute' y
+// tambien sirve para los caminos desempaquetados de 'HubLabels::unpack'.
+//
+// Variables miembro
+//     - nodes         : 'Node::index' de los nodos del camino, de 'src' a 'dest'
+//     - edges         : 'Edge::index' de las aristas del camino (edges[i] une nodes[i] con nodes[i + 1])
+//     - length        : Suma de 'Edge::length'
+//     - sharing       : Mayor longitud compartida con alguna de las rutas anteriores
+//     - plateau       : Longitud de la meseta que la genero (para la optima, el camino completo)
+//
+// Funciones miembro
+//     - osm_ids       : Ids de OSM del camino, incluyendo los nodos contraidos en 'Edge::via'
+// *
+struct AlternativeRoute {
+    std::vector<std::uint32_t> nodes;
+    std::vector<std::uint32_t> edges;
+    double length = 0.0;
+    double sharing = 0.0;
+    double plateau = 0.0;
+
+    std::vector<std::size_t> osm_ids(const Graph &graph) const {
+        std::vector<std::size_t> ids;
+        if (nodes.empty()) return ids;
+        ids.push_back(graph.node_storage[nodes[0]].id);
+        for (std::size_t i = 0; i < edges.size(); ++i) {
+            const Edge *edge = graph.edges[edges[i]];
+            if (edge->src->index == nodes[i]) {
+                ids.insert(ids.end(), edge->via.begin(), edge->via.end());
+            } else {
+                ids.insert(ids.end(), edge->via.rbegin(), edge->via.rend());
+            }
+            ids.push_back(graph.node_storage[nodes[i + 1]].id);
+        }
+        return ids;
+    }
+};
+
+
+// *
+// ---- AlternativeRoutes ----
+// Rutas alternativas por el metodo de nodo intermedio (via-node) con mesetas. Se corre un Dijkstra hacia
+// adelante desde 'src' y otro hacia atras desde 'dest' (sobre 'Graph::backward'), ambos hasta
+// max_stretch * optimo. Para cualquier nodo v, el camino minimo src -> v seguido del camino minimo v -> dest es
+// un candidato de longitud df(v) + db(v), y ambos caminos ya estan en los arboles.
+//
+// Una meseta es una cadena de aristas que pertenecen a los dos arboles a la vez. Todos los nodos de una meseta
+// generan la misma ruta, asi que basta un candidato por meseta (su primer nodo). Una meseta larga indica que la
+// ruta es localmente optima: cada tramo de la longitud de la meseta es un camino minimo, lo que descarta los
+// desvios absurdos (entrar a una calle y volver) que produce tomar cualquier v.
+//
+// Los candidatos se ordenan por 2 * longitud - meseta y se aceptan en ese orden mientras cumplan 'max_stretch',
+// 'min_plateau', 'max_sharing' y no repitan nodos. El costo total es el de dos busquedas acotadas, sin importar k.
+//
+// Funciones miembro
+//     - compute       : Devuelve hasta 'k' rutas; la primera es la optima (vacio si no hay camino)
+// *
+struct AlternativeRoutes {
+    static std::vector<AlternativeRoute> compute(const Graph &graph, std::uint32_t src, std::uint32_t dest,
+                                                 const AlternativeRouteOptions &options = AlternativeRouteOptions(),
+                                                 std::size_t *settled = nullptr) {
+        std::vector<AlternativeRoute> routes;
+        if (settled != nullptr) *settled = 0;
+        if (options.k == 0 || !graph.components.may_reach(src, dest)) return routes;
+
+        std::size_t n = graph.node_storage.size();
+        Tree forward = search(graph.forward, src, dest, options.max_stretch, n);
+        if (forward.dist[dest] == infinity) return routes;
+        Tree backward = search(graph.backward, dest, src, options.max_stretch, n);
+        if (settled != nullptr) *settled = forward.order.size() + backward.order.size();
+
+        double optimum = forward.dist[dest];
+        auto edge_length = [&graph](std::uint32_t e) { return graph.edges[e]->length; };
+
+        // arista u -> v en ambos arboles: v cuelga de u hacia adelante y u cuelga de v hacia atras
+        auto on_plateau = [&](std::uint32_t u, std::uint32_t v) {
+            return forward.parent[v] == u && backward.parent[u] == v &&
+                   forward.parent_edge[v] == backward.parent_edge[u];
+        };
+
+        // 'start': primer nodo de la meseta de cada nodo; 'ahead': longitud de la meseta desde el nodo hacia 'dest'
+        std::vector<std::uint32_t> start(n, none);
+        for (std::uint32_t v: forward.order) {
+            std::uint32_t u = forward.parent[v];
+            start[v] = (u != none && on_plateau(u, v)) ? start[u] : v;
+        }
+        std::vector<double> ahead(n, 0.0);
+        for (std::uint32_t v: backward.order) {
+            std::uint32_t w = backward.parent[v];
+            if (w != none && on_plateau(v, w)) ahead[v] = ahead[w] + edge_length(backward.parent_edge[v]);
+        }
+
+        struct Candidate {
+            std::uint32_t via;
+            double length;
+            double plateau;
+        };
+        std::vector<Candidate> candidates;
+        double limit = options.max_stretch * optimum;
+        for (std::uint32_t v: forward.order) {
+            if (start[v] != v || v == src || backward.dist[v] == infinity) continue;
+            double length = forward.dist[v] + backward.dist[v];
+            if (length <= limit && ahead[v] >= options.min_plateau * optimum) {
+                candidates.push_back({v, length, ahead[v]});
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(), [](const Candidate &a, const Candidate &b) {
+            return 2.0 * a.length - a.plateau < 2.0 * b.length - b.plateau;
+        });
+
+        routes.push_back(build(forward, backward, src, src, edge_length));
+        routes[0].plateau = optimum;
+
+        std::vector<char> seen(n, false);
+        for (const Candidate &candidate: candidates) {
+            if (routes.size() >= options.k) break;
+
+            AlternativeRoute route = build(forward, backward, src, candidate.via, edge_length);
+            route.plateau = candidate.plateau;
+            if (!simple(route, seen)) continue;
+
+            for (const AlternativeRoute &chosen: routes) {
+                route.sharing = std::max(route.sharing, shared_length(route, chosen, edge_length));
+            }
+            if (route.sharing <= options.max_sharing * optimum) {
+                routes.push_back(std::move(route));
+            }
+        }
+        return routes;
+    }
+
+private:
+    static constexpr std::uint32_t none = std::numeric_limits<std::uint32_t>::max();
+    static constexpr double infinity = std::numeric_limits<double>::max();
+
+    // Arbol de caminos minimos: 'parent' es el nodo anterior (hacia adelante) o siguiente (hacia atras)
+    struct Tree {
+        std::vector<double> dist;
+        std::vector<std::uint32_t> parent;
+        std::vector<std::uint32_t> parent_edge;
+        std::vector<std::uint32_t> order;  // nodos en el orden en que se procesaron
+    };
+
+    //* --- search ---
+    // Dijkstra desde 'root' sobre 'adjacency'. Cuando procesa 'target' fija el limite en stretch * dist(target)
+    // y se detiene al superarlo; si 'target' no aparece, recorre todo lo alcanzable.
+    //*
+    static Tree search(const Adjacency &adjacency, std::uint32_t root, std::uint32_t target, double stretch,
+                       std::size_t n) {
+        Tree tree;
+        tree.dist.assign(n, infinity);
+        tree.parent.assign(n, none);
+        tree.parent_edge.assign(n, none);
+        std::vector<char> closed(n, false);
+
+        typedef std::pair<double, std::uint32_t> QueueEntry;
+        std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> pq;
+        tree.dist[root] = 0.0;
+        pq.push({0.0, root});
+
+        double limit = infinity;
+        while (!pq.empty()) {
+            auto [d, u] = pq.top();
+            pq.pop();
+            if (closed[u]) continue;
+            if (d > limit) break;
+            closed[u] = true;
+            tree.order.push_back(u);
+            if (u == target) limit = stretch * d;
+
+            for (const Arc *arc = adjacency.begin(u); arc != adjacency.end(u); ++arc) {
+                double candidate = d + arc->length;
+                if (candidate < tree.dist[arc->to]) {
+                    tree.dist[arc->to] = candidate;
+                    tree.parent[arc->to] = u;
+                    tree.parent_edge[arc->to] = arc->edge;
+                    pq.push({candidate, arc->to});
+                }
+            }
+        }
+
+        // los nodos que quedaron en la cola no estan en el arbol
+        for (std::uint32_t u = 0; u < n; ++u) {
+            if (!closed[u]) {
+                tree.dist[u] = infinity;
+                tree.parent[u] = none;
+            }
+        }
+        return tree;
+    }
+
+    // src -> via por el arbol hacia adelante y via -> dest por el arbol hacia atras
+    template<typename Length>
+    static AlternativeRoute build(const Tree &forward, const Tree &backward, std::uint32_t src, std::uint32_t via,
+                                  Length edge_length) {
+        AlternativeRoute route;
+        for (std::uint32_t v = via; v != src; v = forward.parent[v]) {
+            route.nodes.push_back(v);
+            route.edges.push_back(forward.parent_edge[v]);
+        }
+        route.nodes.push_back(src);
+        std::reverse(route.nodes.begin(), route.nodes.end());
+        std::reverse(route.edges.begin(), route.edges.end());
+
+        for (std::uint32_t v = via; backward.parent[v] != none; v = backward.parent[v]) {
+            route.edges.push_back(backward.parent_edge[v]);
+            route.nodes.push_back(backward.parent[v]);
+        }
+
+        for (std::uint32_t e: route.edges) {
+            route.length += edge_length(e);
+        }
+        return route;
+    }
+
+    // false si la ruta pasa dos veces por un nodo; 'seen' queda limpio al salir
+    static bool simple(const AlternativeRoute &route, std::vector<char> &seen) {
+        bool repeated = false;
+        for (std::uint32_t v: route.nodes) {
+            if (seen[v]) repeated = true;
+            seen[v] = true;
+        }
+        for (std::uint32_t v: route.nodes) {
+            seen[v] = false;
+        }
+        return !repeated;
+    }
+
+    template<typename Length>
+    static double shared_length(const AlternativeRoute &a, const AlternativeRoute &b, Length edge_length) {
+        std::vector<std::uint32_t> x = a.edges, y = b.edges, common;
+        std::sort(x.begin(), x.end());
+        std::sort(y.begin(), y.end());
+        std::set_intersection(x.begin(), x.end(), y.begin(), y.end(), std::back_inserter(common));
+
+        double length = 0.0;
+        for (std::uint32_t e: common) {
+            length += edge_length(e);
+        }
+        return length;
+    }
+};
+
+
+#endif //HOMEWORK_GRAPH_ALTERNATIVE_ROUTES_H
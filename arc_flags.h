@@ -0,0 +1,191 @@
+//
+// Created by juan-diego on 3/29/24.
+//
+
+#ifndef HOMEWORK_GRAPH_ARC_FLAGS_H
+#define HOMEWORK_GRAPH_ARC_FLAGS_H
+
+#include "adjacency.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <queue>
+#include <thread>
+#include <vector>
+
+
+// Una bandera por region; como maximo 64 regiones
+typedef std::uint64_t RegionMask;
+
+
+// *
+// ---- ArcFlags ----
+// Aceleracion de Dijkstra por "arc flags". Los nodos se dividen en regiones segun 'coord' (un kd-tree que
+// parte por la mediana del eje mas largo, asi todas las regiones tienen casi la misma cantidad de nodos), y cada
+// arco u -> v guarda una bandera por region R que indica si el arco es el inicio de algun camino minimo hacia
+// un nodo de R. Una busqueda hacia 'dest' puede ignorar todos los arcos sin la bandera de la region de 'dest'
+// y sigue siendo exacta.
+//
+// Para calcular las banderas de R se corre un Dijkstra hacia atras desde cada nodo frontera de R (nodos de R
+// con un arco que llega desde otra region); todo arco u -> v con dist(u) = length + dist(v) esta en un camino
+// minimo hacia ese nodo frontera. Los arcos dentro de R siempre llevan la bandera de R. Los Dijkstra son
+// independientes, asi que se reparten entre hilos y cada hilo acumula sus banderas por separado.
+//
+// Variables miembro
+//     - region        : Region de cada nodo, indexada por 'Node::index'
+//     - flags         : Banderas de cada arco, paralelo a 'Adjacency::arcs' de la adyacencia hacia adelante
+//     - boundary_nodes: Cantidad de nodos frontera (uno por cada Dijkstra del preprocesamiento)
+//
+// Funciones miembro
+//     - build         : Particiona en 2^levels regiones y calcula las banderas con 'threads' hilos
+//     - empty         : true si aun no se calcularon las banderas
+//     - allows        : true si el arco 'arc' puede llevar a la region 'target_region'
+// *
+struct ArcFlags {
+    std::vector<std::uint8_t> region;
+    std::vector<RegionMask> flags;
+    std::size_t boundary_nodes = 0;
+
+    bool empty() const {
+        return flags.empty();
+    }
+
+    bool allows(std::size_t arc, std::uint8_t target_region) const {
+        return (flags[arc] >> target_region) & 1u;
+    }
+
+    void build(const Adjacency &forward, const Adjacency &backward,
+               const std::vector<float> &xs, const std::vector<float> &ys,
+               int levels = 5, unsigned threads = std::thread::hardware_concurrency()) {
+        levels = std::max(0, std::min(levels, 6));
+        threads = std::max(1u, threads);
+        std::size_t n = forward.node_count();
+
+        partition(xs, ys, levels);
+
+        // nodos frontera: tienen un arco entrante desde otra region
+        std::vector<std::uint32_t> boundary;
+        for (std::uint32_t v = 0; v < n; ++v) {
+            for (const Arc *arc = backward.begin(v); arc != backward.end(v); ++arc) {
+                if (region[arc->to] != region[v]) {
+                    boundary.push_back(v);
+                    break;
+                }
+            }
+        }
+        boundary_nodes = boundary.size();
+
+        // arcos dentro de una misma region
+        flags.assign(forward.arcs.size(), 0);
+        for (std::uint32_t u = 0; u < n; ++u) {
+            for (std::size_t a = forward.offsets[u]; a < forward.offsets[u + 1]; ++a) {
+                if (region[forward.arcs[a].to] == region[u]) {
+                    flags[a] |= RegionMask(1) << region[u];
+                }
+            }
+        }
+
+        std::atomic<std::size_t> next {0};
+        std::vector<std::vector<RegionMask>> partial(threads);
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t]() {
+                std::vector<RegionMask> &local = partial[t];
+                local.assign(forward.arcs.size(), 0);
+                std::vector<double> dist(n, std::numeric_limits<double>::max());
+                std::vector<std::uint32_t> touched;
+
+                for (std::size_t i = next++; i < boundary.size(); i = next++) {
+                    std::uint32_t target = boundary[i];
+                    backward_dijkstra(backward, target, dist, touched);
+                    RegionMask bit = RegionMask(1) << region[target];
+
+                    for (std::uint32_t u: touched) {
+                        for (std::size_t a = forward.offsets[u]; a < forward.offsets[u + 1]; ++a) {
+                            const Arc &arc = forward.arcs[a];
+                            if (dist[arc.to] == std::numeric_limits<double>::max()) continue;
+                            if (std::abs(dist[u] - (arc.length + dist[arc.to])) <= 1e-9 * (1.0 + dist[u])) {
+                                local[a] |= bit;
+                            }
+                        }
+                    }
+
+                    for (std::uint32_t u: touched) {
+                        dist[u] = std::numeric_limits<double>::max();
+                    }
+                }
+            });
+        }
+        for (std::thread &worker: workers) {
+            worker.join();
+        }
+        for (auto &local: partial) {
+            for (std::size_t a = 0; a < flags.size(); ++a) {
+                flags[a] |= local[a];
+            }
+        }
+    }
+
+private:
+    // kd-tree: divide por la mediana de la coordenada de mayor extension, 'levels' veces
+    void partition(const std::vector<float> &xs, const std::vector<float> &ys, int levels) {
+        region.assign(xs.size(), 0);
+        std::vector<std::uint32_t> order(xs.size());
+        std::iota(order.begin(), order.end(), 0);
+
+        std::function<void(std::size_t, std::size_t, int, std::uint8_t)> split =
+                [&](std::size_t begin, std::size_t end, int depth, std::uint8_t id) {
+                    if (depth == levels || end - begin < 2) {
+                        for (std::size_t i = begin; i < end; ++i) region[order[i]] = id;
+                        return;
+                    }
+                    auto [min_x, max_x] = std::minmax_element(order.begin() + begin, order.begin() + end,
+                                                              [&](std::uint32_t a, std::uint32_t b) { return xs[a] < xs[b]; });
+                    auto [min_y, max_y] = std::minmax_element(order.begin() + begin, order.begin() + end,
+                                                              [&](std::uint32_t a, std::uint32_t b) { return ys[a] < ys[b]; });
+                    const std::vector<float> &axis =
+                            xs[*max_x] - xs[*min_x] >= ys[*max_y] - ys[*min_y] ? xs : ys;
+
+                    std::size_t middle = begin + (end - begin) / 2;
+                    std::nth_element(order.begin() + begin, order.begin() + middle, order.begin() + end,
+                                     [&axis](std::uint32_t a, std::uint32_t b) { return axis[a] < axis[b]; });
+                    split(begin, middle, depth + 1, static_cast<std::uint8_t>(id * 2));
+                    split(middle, end, depth + 1, static_cast<std::uint8_t>(id * 2 + 1));
+                };
+        split(0, order.size(), 0, 0);
+    }
+
+    // Dijkstra desde 'target' sobre los arcos invertidos: dist[u] = distancia de u a 'target'.
+    // 'touched' termina con todos los nodos alcanzados, para poder limpiar 'dist' sin recorrerlo entero.
+    static void backward_dijkstra(const Adjacency &backward, std::uint32_t target,
+                                  std::vector<double> &dist, std::vector<std::uint32_t> &touched) {
+        typedef std::pair<double, std::uint32_t> QueueEntry;
+        std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> pq;
+        touched.clear();
+
+        dist[target] = 0.0;
+        touched.push_back(target);
+        pq.push({0.0, target});
+        while (!pq.empty()) {
+            auto [d, v] = pq.top();
+            pq.pop();
+            if (d > dist[v]) continue;
+
+            for (const Arc *arc = backward.begin(v); arc != backward.end(v); ++arc) {
+                double candidate = d + arc->length;
+                if (candidate < dist[arc->to]) {
+                    if (dist[arc->to] == std::numeric_limits<double>::max()) touched.push_back(arc->to);
+                    dist[arc->to] = candidate;
+                    pq.push({candidate, arc->to});
+                }
+            }
+        }
+    }
+};
+
+
+#endif //HOMEWORK_GRAPH_ARC_FLAGS_H
@@ -0,0 +1,312 @@
+//
+// Created by juan-diego on 3/29/24.
+//
+
+#ifndef HOMEWORK_GRAPH_COMPACT_GRAPH_H
+#define HOMEWORK_GRAPH_COMPACT_GRAPH_H
+
+
+#include "graph.h"
+#include "compressed_adjacency.h"
+#include "search_budget.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <queue>
+#include <vector>
+
+
+// *
+// ---- CompactGraph ----
+// Grafo solo con la adyacencia comprimida, para mapas que no entran en memoria como 'Graph'. Dentro de
+// 'Graph', 'compressed' convive con 'nodes', 'edges', 'forward' y 'backward' (la GUI y los demas algoritmos
+// los necesitan), asi que alli suma memoria en lugar de ahorrarla; el ahorro esta aqui.
+//
+// 'load' lee los csv directamente, sin crear 'Node' ni 'Edge':
+//     1. nodes.csv -> ids y coordenadas, ordenados por curva de Hilbert (ver 'NodeReordering::hilbert_index')
+//     2. edges.csv, primera pasada: grado de salida de cada nodo
+//     3. edges.csv, segunda pasada: los arcos de cada nodo en su lugar de un arreglo de 'CompressedArc'
+//     4. codificacion nodo por nodo con 'CompressedAdjacency::append' y se libera el arreglo
+// El pico es de ~12 bytes por arco (el arreglo del paso 3) mas 24 por nodo; al terminar quedan ~5 bytes por
+// arco. 'Graph' usa un 'Edge' (mas de 100 bytes con sus vectores) mas 32 bytes de CSR por arista.
+// No se simplifica el grafo (ver 'graph_simplifier.h'): todos los ids de nodes.csv siguen siendo nodos. Las
+// aristas con extremos inexistentes o lazos se descartan, y de los arcos paralelos se guarda el mas corto.
+//
+// Variables miembro
+//     - adjacency     : Adyacencia comprimida (ver 'CompressedAdjacency')
+//     - xs, ys        : Coordenadas SoA, indexadas por indice denso
+//     - ids           : Id de OSM de cada indice
+//     - by_id         : Indices ordenados por id de OSM, para 'find'
+//
+// Funciones miembro
+//     - load          : Lee los csv en la forma comprimida (ver arriba); false si no se pudo abrir alguno
+//     - assign        : Copia la forma comprimida de un 'Graph' ya cargado
+//     - find          : Indice de un id de OSM
+//     - memory_bytes  : Memoria total de la estructura
+// *
+struct CompactGraph {
+    CompressedAdjacency adjacency;
+    std::vector<float> xs;
+    std::vector<float> ys;
+    std::vector<std::uint64_t> ids;
+    std::vector<std::uint32_t> by_id;
+
+    bool load(const std::string &nodes_path, const std::string &edges_path) {
+        std::ifstream nodes_file(nodes_path);
+        std::ifstream edges_file(edges_path);
+        if (!nodes_file || !edges_file) return false;
+
+        std::string line;
+        std::vector<char *> fields;
+        std::getline(nodes_file, line);
+        ids.clear();
+        xs.clear();
+        ys.clear();
+        while (std::getline(nodes_file, line)) {
+            if (split(line, fields) < 3) continue;
+            ids.push_back(std::strtoull(fields[0], nullptr, 10));
+            ys.push_back(std::strtof(fields[1], nullptr));
+            xs.push_back(std::strtof(fields[2], nullptr));
+        }
+        hilbert_sort();
+
+        // primera pasada: grado de salida de cada nodo, en 'offsets' desplazado en uno
+        std::vector<std::uint32_t> offsets(size() + 1, 0);
+        for_each_edge(edges_file, [&](std::uint32_t src, std::uint32_t dest, const CompressedArc &, bool one_way) {
+            offsets[src + 1]++;
+            if (!one_way) offsets[dest + 1]++;
+        });
+        for (std::size_t u = 0; u < size(); ++u) {
+            offsets[u + 1] += offsets[u];
+        }
+
+        // segunda pasada: cada arco en su lugar
+        std::vector<CompressedArc> arcs(offsets.back());
+        std::vector<std::uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+        edges_file.clear();
+        edges_file.seekg(0);
+        for_each_edge(edges_file, [&](std::uint32_t src, std::uint32_t dest, const CompressedArc &arc, bool one_way) {
+            arcs[cursor[src]++] = arc;
+            if (!one_way) {
+                arcs[cursor[dest]++] = arc;
+                arcs[cursor[dest] - 1].to = src;
+            }
+        });
+
+        adjacency.reset(size(), arcs.size());
+        for (std::size_t u = 0; u < size(); ++u) {
+            adjacency.append(arcs.data() + offsets[u], arcs.data() + offsets[u + 1]);
+        }
+        adjacency.finish();
+        return true;
+    }
+
+    void assign(Graph &graph) {
+        if (graph.compressed.empty()) {
+            graph.build_compressed();
+        }
+        adjacency = graph.compressed;
+        xs = graph.xs;
+        ys = graph.ys;
+
+        ids.resize(graph.node_storage.size());
+        by_id.resize(graph.node_storage.size());
+        for (const Node &node: graph.node_storage) {
+            ids[node.index] = node.id;
+            by_id[node.index] = static_cast<std::uint32_t>(node.index);
+        }
+        std::sort(by_id.begin(), by_id.end(), [&](std::uint32_t a, std::uint32_t b) { return ids[a] < ids[b]; });
+    }
+
+    bool find(std::uint64_t id, std::uint32_t &index) const {
+        auto it = std::lower_bound(by_id.begin(), by_id.end(), id,
+                                   [&](std::uint32_t i, std::uint64_t value) { return ids[i] < value; });
+        if (it == by_id.end() || ids[*it] != id) return false;
+        index = *it;
+        return true;
+    }
+
+    std::size_t size() const {
+        return ids.size();
+    }
+
+    std::size_t memory_bytes() const {
+        return adjacency.memory_bytes() + (xs.size() + ys.size()) * sizeof(float) +
+               ids.size() * sizeof(std::uint64_t) + by_id.size() * sizeof(std::uint32_t);
+    }
+
+private:
+    // Separa 'line' por comas en el lugar; devuelve la cantidad de campos
+    static std::size_t split(std::string &line, std::vector<char *> &fields) {
+        fields.clear();
+        if (line.empty()) return 0;
+        char *cursor = &line[0];
+        fields.push_back(cursor);
+        for (; *cursor != '\0'; ++cursor) {
+            if (*cursor == ',') {
+                *cursor = '\0';
+                fields.push_back(cursor + 1);
+            }
+        }
+        return fields.size();
+    }
+
+    // Renumera los nodos por su posicion en una curva de Hilbert (como 'HilbertOrder') y arma 'by_id'
+    void hilbert_sort() {
+        std::size_t n = ids.size();
+        float min_x = std::numeric_limits<float>::max(), min_y = std::numeric_limits<float>::max();
+        float max_x = std::numeric_limits<float>::lowest(), max_y = std::numeric_limits<float>::lowest();
+        for (std::size_t i = 0; i < n; ++i) {
+            min_x = std::min(min_x, xs[i]);
+            min_y = std::min(min_y, ys[i]);
+            max_x = std::max(max_x, xs[i]);
+            max_y = std::max(max_y, ys[i]);
+        }
+        const double cells = (1u << 16) - 1;
+        double scale_x = max_x > min_x ? cells / (max_x - min_x) : 0.0;
+        double scale_y = max_y > min_y ? cells / (max_y - min_y) : 0.0;
+
+        std::vector<std::pair<std::uint64_t, std::uint32_t>> keyed(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            auto x = static_cast<std::uint32_t>((xs[i] - min_x) * scale_x);
+            auto y = static_cast<std::uint32_t>((ys[i] - min_y) * scale_y);
+            keyed[i] = {NodeReordering::hilbert_index(x, y), static_cast<std::uint32_t>(i)};
+        }
+        std::sort(keyed.begin(), keyed.end());
+
+        std::vector<std::uint64_t> sorted_ids(n);
+        std::vector<float> sorted_xs(n), sorted_ys(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            sorted_ids[i] = ids[keyed[i].second];
+            sorted_xs[i] = xs[keyed[i].second];
+            sorted_ys[i] = ys[keyed[i].second];
+        }
+        ids.swap(sorted_ids);
+        xs.swap(sorted_xs);
+        ys.swap(sorted_ys);
+
+        by_id.resize(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            by_id[i] = static_cast<std::uint32_t>(i);
+        }
+        std::sort(by_id.begin(), by_id.end(), [&](std::uint32_t a, std::uint32_t b) { return ids[a] < ids[b]; });
+    }
+
+    // Llama a 'visit(src, dest, arco src -> dest, one_way)' por cada fila valida de edges.csv
+    // (source,target,max_speed,length,oneway,lanes)
+    template<typename Visit>
+    void for_each_edge(std::ifstream &file, Visit visit) const {
+        std::string line;
+        std::vector<char *> fields;
+        std::getline(file, line);
+        while (std::getline(file, line)) {
+            if (split(line, fields) < 6) continue;
+            std::uint32_t src, dest;
+            if (!find(std::strtoull(fields[0], nullptr, 10), src) ||
+                !find(std::strtoull(fields[1], nullptr, 10), dest) || src == dest) {
+                continue;
+            }
+            bool one_way = std::strncmp(fields[4], "True", 4) == 0;
+            visit(src, dest, CompressedAdjacency::encode(dest, std::strtod(fields[3], nullptr), one_way,
+                                                         std::atoi(fields[5]), std::atoi(fields[2])), one_way);
+        }
+    }
+};
+
+
+// *
+// ---- CompactRoute ----
+// Resultado de 'CompactSearch::run'.
+//
+// Variables miembro
+//     - status        : Found, Unreachable o el limite que detuvo la busqueda
+//     - cost          : Costo del camino en metros (suma de los pesos cuantizados, ver 'CompressedArc')
+//     - path          : Ids de OSM de los nodos del camino, de 'src' a 'dest'
+//     - settled       : Nodos procesados
+//     - memory_bytes  : Memoria estimada de las estructuras de la busqueda al terminar
+// *
+struct CompactRoute {
+    SearchStatus status = NotRun;
+    double cost = 0.0;
+    std::vector<std::uint64_t> path;
+    std::size_t settled = 0;
+    std::size_t memory_bytes = 0;
+};
+
+
+// *
+// ---- CompactSearch ----
+// El mismo Dijkstra con distancias enteras que 'PathFindingManager::compressed_dijkstra', pero sobre un
+// 'CompactGraph': los padres son indices y el camino se arma con 'CompactGraph::ids', sin 'Node' ni 'Edge'.
+//
+// Funciones miembro
+//     - run           : Busqueda de 'src' a 'dest' (indices, ver 'CompactGraph::find') con los limites de
+//                       'budget' y 'token'
+// *
+struct CompactSearch {
+    static CompactRoute run(const CompactGraph &graph, std::uint32_t src, std::uint32_t dest,
+                            const SearchBudget &budget = SearchBudget(), const CancellationToken *token = nullptr) {
+        const std::uint32_t no_parent = std::numeric_limits<std::uint32_t>::max();
+        const std::uint64_t inf = std::numeric_limits<std::uint64_t>::max();
+        typedef std::pair<std::uint64_t, std::uint32_t> QueueEntry;
+
+        CompactRoute route;
+        BudgetGuard guard(budget, token);
+
+        std::vector<std::uint32_t> parent(graph.size(), no_parent);
+        std::vector<std::uint64_t> dist(graph.size(), inf);
+        std::vector<char> closed_set(graph.size(), false);
+        std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> pq;
+        std::size_t fixed_memory = graph.size() * (sizeof(std::uint32_t) + sizeof(std::uint64_t) + sizeof(char));
+
+        dist[src] = 0;
+        pq.push({0, src});
+
+        route.status = Unreachable;
+        while (!pq.empty()) {
+            std::uint32_t u = pq.top().second;
+            pq.pop();
+            if (closed_set[u]) continue;
+            closed_set[u] = true;
+            route.settled++;
+
+            if (u == dest) {
+                route.status = Found;
+                break;
+            }
+            SearchStatus stop = guard.check(route.settled, fixed_memory + pq.size() * sizeof(QueueEntry));
+            if (stop != NotRun) {
+                route.status = stop;
+                break;
+            }
+
+            CompressedArc arc {};
+            for (auto it = graph.adjacency.arcs(u); it.next(arc);) {
+                if (closed_set[arc.to]) continue;
+                std::uint64_t new_dist = dist[u] + arc.weight;
+                if (new_dist < dist[arc.to]) {
+                    dist[arc.to] = new_dist;
+                    parent[arc.to] = u;
+                    pq.push({new_dist, arc.to});
+                }
+            }
+        }
+        route.memory_bytes = fixed_memory + pq.size() * sizeof(QueueEntry);
+
+        if (route.status == Found) {
+            route.cost = dist[dest] / 10.0;
+            for (std::uint32_t v = dest; v != no_parent; v = parent[v]) {
+                route.path.push_back(graph.ids[v]);
+            }
+            std::reverse(route.path.begin(), route.path.end());
+        }
+        return route;
+    }
+};
+
+
+#endif //HOMEWORK_GRAPH_COMPACT_GRAPH_H
@@ -0,0 +1,160 @@
+//
+// Created by juan-diego on 3/29/24.
+//
+
+#ifndef HOMEWORK_GRAPH_COMPONENTS_H
+#define HOMEWORK_GRAPH_COMPONENTS_H
+
+#include "adjacency.h"
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+
+// *
+// ---- Components ----
+// Componentes fuertemente conexas (respetando 'one_way') y debilmente conexas del grafo, calculadas una sola
+// vez al cargar. Sirven para responder en O(1) muchas consultas sin camino, que de otra forma obligan a
+// Dijkstra y A* a procesar todo lo alcanzable desde 'src' antes de rendirse.
+//
+// Las fuertes se calculan con Tarjan iterativo (sin recursion, el grafo de Lima desbordaria la pila). Tarjan
+// cierra las componentes en orden topologico inverso, por lo que si existe un arco de la componente A a otra
+// componente B entonces scc[A] > scc[B]. De ahi:
+//     - mismo 'scc'                          -> 'dest' siempre es alcanzable
+//     - distinto 'wcc' o scc[src] < scc[dest] -> 'dest' nunca es alcanzable
+//     - en otro caso                          -> hay que buscar
+//
+// Variables miembro
+//     - scc           : Componente fuerte de cada nodo, indexada por 'Node::index'
+//     - wcc           : Componente debil de cada nodo (ignorando la direccion de los arcos)
+//     - scc_size      : Cantidad de nodos de cada componente fuerte
+//     - largest       : Id de la componente fuerte mas grande
+//
+// Funciones miembro
+//     - build         : Calcula ambas particiones a partir de la adyacencia hacia adelante
+//     - may_reach     : false solo si es seguro que no existe camino de u a v
+//     - in_largest    : true si el nodo pertenece a la componente fuerte mas grande
+// *
+struct Components {
+    std::vector<std::uint32_t> scc;
+    std::vector<std::uint32_t> wcc;
+    std::vector<std::uint32_t> scc_size;
+    std::uint32_t largest = 0;
+
+    void build(const Adjacency &forward) {
+        strong(forward);
+        weak(forward);
+    }
+
+    bool may_reach(std::size_t u, std::size_t v) const {
+        if (scc.empty()) return true;
+        if (wcc[u] != wcc[v]) return false;
+        return scc[u] >= scc[v];
+    }
+
+    bool in_largest(std::size_t u) const {
+        return scc.empty() || scc[u] == largest;
+    }
+
+private:
+    void strong(const Adjacency &forward) {
+        const std::uint32_t unvisited = UINT32_MAX;
+        std::size_t n = forward.node_count();
+
+        std::vector<std::uint32_t> order(n, unvisited);
+        std::vector<std::uint32_t> low(n, 0);
+        std::vector<char> on_stack(n, false);
+        std::vector<std::uint32_t> stack;
+
+        // pila de llamadas: nodo y posicion del siguiente arco a revisar
+        struct Frame {
+            std::uint32_t node;
+            std::uint32_t next_arc;
+        };
+        std::vector<Frame> calls;
+
+        scc.assign(n, 0);
+        scc_size.clear();
+        std::uint32_t counter = 0;
+
+        for (std::uint32_t start = 0; start < n; ++start) {
+            if (order[start] != unvisited) continue;
+
+            order[start] = low[start] = counter++;
+            stack.push_back(start);
+            on_stack[start] = true;
+            calls.push_back({start, forward.offsets[start]});
+
+            while (!calls.empty()) {
+                Frame &frame = calls.back();
+                std::uint32_t v = frame.node;
+
+                if (frame.next_arc < forward.offsets[v + 1]) {
+                    std::uint32_t w = forward.arcs[frame.next_arc++].to;
+                    if (order[w] == unvisited) {
+                        order[w] = low[w] = counter++;
+                        stack.push_back(w);
+                        on_stack[w] = true;
+                        calls.push_back({w, forward.offsets[w]});
+                    } else if (on_stack[w]) {
+                        low[v] = std::min(low[v], order[w]);
+                    }
+                    continue;
+                }
+
+                calls.pop_back();
+                if (low[v] == order[v]) {
+                    auto id = static_cast<std::uint32_t>(scc_size.size());
+                    std::uint32_t size = 0;
+                    std::uint32_t w;
+                    do {
+                        w = stack.back();
+                        stack.pop_back();
+                        on_stack[w] = false;
+                        scc[w] = id;
+                        size++;
+                    } while (w != v);
+                    scc_size.push_back(size);
+                }
+                if (!calls.empty()) {
+                    std::uint32_t u = calls.back().node;
+                    low[u] = std::min(low[u], low[v]);
+                }
+            }
+        }
+
+        largest = 0;
+        for (std::uint32_t id = 0; id < scc_size.size(); ++id) {
+            if (scc_size[id] > scc_size[largest]) largest = id;
+        }
+    }
+
+    // union-find con compresion de caminos
+    void weak(const Adjacency &forward) {
+        std::size_t n = forward.node_count();
+        wcc.resize(n);
+        std::iota(wcc.begin(), wcc.end(), 0);
+
+        auto find = [this](std::uint32_t u) {
+            while (wcc[u] != u) {
+                wcc[u] = wcc[wcc[u]];
+                u = wcc[u];
+            }
+            return u;
+        };
+
+        for (std::uint32_t u = 0; u < n; ++u) {
+            for (const Arc *arc = forward.begin(u); arc != forward.end(u); ++arc) {
+                std::uint32_t a = find(u), b = find(arc->to);
+                if (a != b) wcc[std::max(a, b)] = std::min(a, b);
+            }
+        }
+        for (std::uint32_t u = 0; u < n; ++u) {
+            wcc[u] = find(u);
+        }
+    }
+};
+
+
+#endif //HOMEWORK_GRAPH_COMPONENTS_H
@@ -0,0 +1,195 @@
+//
+// Created by juan-diego on 3/29/24.
+//
+
+#ifndef HOMEWORK_GRAPH_COMPRESSED_ADJACENCY_H
+#define HOMEWORK_GRAPH_COMPRESSED_ADJACENCY_H
+
+#include "adjacency.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+
+// *
+// ---- CompressedArc ----
+// Un arco decodificado de 'CompressedAdjacency'.
+//
+// Variables miembro
+//     - to            : 'Node::index' del otro extremo
+//     - weight        : Longitud cuantizada en decimetros (round(length * 10))
+//     - one_way       : 'Edge::one_way' de la arista original
+//     - lanes         : 'Edge::lanes', saturado a 7
+//     - speed_class   : 'Edge::max_speed' / 10, saturado a 15
+// *
+struct CompressedArc {
+    std::uint32_t to;
+    std::uint32_t weight;
+    bool one_way;
+    std::uint8_t lanes;
+    std::uint8_t speed_class;
+
+    double length() const {
+        return weight / 10.0;
+    }
+};
+
+
+// *
+// ---- CompressedAdjacency ----
+// Adyacencia hacia adelante comprimida, para grafos mucho mas grandes que Lima. Los arcos de cada nodo se
+// ordenan por destino y se guardan como una secuencia de bytes:
+//     - destino       : varint del primer destino relativo al propio nodo (en zigzag, puede ser negativo) y
+//                       luego varint de la diferencia con el destino anterior. Con los nodos ordenados por
+//                       Hilbert (ver 'node_ordering.h') las diferencias son pequeñas y caben en 1-2 bytes
+//     - peso          : varint de la longitud en decimetros
+//     - atributos     : un byte con 'one_way' (bit 0), 'lanes' (bits 1-3) y la clase de velocidad (bits 4-7)
+// Un arco tipico ocupa 4-5 bytes en lugar de los 16 de 'Arc'. No guarda el 'Edge' de origen: para dibujar el
+// camino se usa 'Node::edges'. Dentro de 'Graph' se suma a 'forward' y a los 'Edge', no los reemplaza; el
+// ahorro de memoria real esta en 'CompactGraph' (ver 'compact_graph.h'), que se queda solo con esta estructura.
+//
+// Funciones miembro
+//     - build         : Codifica la adyacencia a partir de 'Graph::forward' y 'Graph::edges'
+//     - reset / append / finish: Codificacion incremental, nodo por nodo, sin pasar por 'Adjacency' ni 'Edge'
+//                       (la usa 'CompactGraph::load' mientras lee los csv)
+//     - arcs          : Iterador que decodifica los arcos de un nodo sobre la marcha
+//     - memory_bytes  : Memoria total de la estructura
+// *
+class CompressedAdjacency {
+    std::vector<std::uint32_t> offsets;
+    std::vector<std::uint8_t> bytes;
+
+public:
+    class ArcIterator {
+        const std::uint8_t *cursor;
+        const std::uint8_t *end;
+        std::int64_t previous;
+        bool first = true;
+
+        std::uint64_t read_varint() {
+            std::uint64_t value = 0;
+            int shift = 0;
+            std::uint8_t byte;
+            do {
+                byte = *cursor++;
+                value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+                shift += 7;
+            } while (byte & 0x80);
+            return value;
+        }
+
+    public:
+        ArcIterator(const std::uint8_t *begin, const std::uint8_t *end, std::uint32_t node)
+                : cursor(begin), end(end), previous(node) {}
+
+        // Decodifica el siguiente arco en 'arc'; devuelve false cuando no quedan arcos
+        bool next(CompressedArc &arc) {
+            if (cursor == end) return false;
+
+            std::uint64_t delta = read_varint();
+            if (first) {
+                // zigzag: 0, -1, 1, -2, ... -> 0, 1, 2, 3, ...
+                previous += static_cast<std::int64_t>(delta >> 1) ^ -static_cast<std::int64_t>(delta & 1);
+                first = false;
+            } else {
+                previous += static_cast<std::int64_t>(delta);
+            }
+            arc.to = static_cast<std::uint32_t>(previous);
+            arc.weight = static_cast<std::uint32_t>(read_varint());
+
+            std::uint8_t attributes = *cursor++;
+            arc.one_way = attributes & 1u;
+            arc.lanes = (attributes >> 1) & 7u;
+            arc.speed_class = attributes >> 4;
+            return true;
+        }
+    };
+
+    void build(const Adjacency &forward, const std::vector<Edge *> &edges) {
+        std::size_t n = forward.node_count();
+        reset(n, forward.arcs.size());
+
+        std::vector<CompressedArc> arcs;
+        for (std::size_t u = 0; u < n; ++u) {
+            arcs.clear();
+            for (const Arc *arc = forward.begin(u); arc != forward.end(u); ++arc) {
+                const Edge *edge = edges[arc->edge];
+                arcs.push_back(encode(arc->to, arc->length, edge->one_way, edge->lanes, edge->max_speed));
+            }
+            append(arcs.data(), arcs.data() + arcs.size());
+        }
+        finish();
+    }
+
+    // Arco con los atributos ya cuantizados y saturados como los guarda 'append'
+    static CompressedArc encode(std::uint32_t to, double length, bool one_way, int lanes, int max_speed) {
+        return {to, static_cast<std::uint32_t>(std::llround(length * 10.0)), one_way,
+                static_cast<std::uint8_t>(std::min(std::max(lanes, 0), 7)),
+                static_cast<std::uint8_t>(std::min(std::max(max_speed / 10, 0), 15))};
+    }
+
+    // 'arcs' es una estimacion para reservar memoria (0 = sin reservar)
+    void reset(std::size_t n, std::size_t arcs = 0) {
+        offsets.clear();
+        offsets.reserve(n + 1);
+        bytes.clear();
+        bytes.reserve(arcs * 5);
+    }
+
+    // Codifica los arcos del siguiente nodo (se llama con los nodos en orden 0, 1, ...). Ordena [first, last)
+    // por destino; si hay arcos paralelos se guarda el mas corto
+    void append(CompressedArc *first, CompressedArc *last) {
+        auto u = static_cast<std::uint32_t>(offsets.size());
+        offsets.push_back(static_cast<std::uint32_t>(bytes.size()));
+        std::sort(first, last, [](const CompressedArc &a, const CompressedArc &b) {
+            return a.to != b.to ? a.to < b.to : a.weight < b.weight;
+        });
+
+        std::int64_t previous = static_cast<std::int64_t>(u);
+        for (CompressedArc *arc = first; arc != last; ++arc) {
+            if (arc != first && arc->to == (arc - 1)->to) continue;
+
+            std::int64_t delta = static_cast<std::int64_t>(arc->to) - previous;
+            if (arc == first) {
+                write_varint((static_cast<std::uint64_t>(delta) << 1) ^ static_cast<std::uint64_t>(delta >> 63));
+            } else {
+                write_varint(static_cast<std::uint64_t>(delta));
+            }
+            previous = arc->to;
+
+            write_varint(arc->weight);
+            bytes.push_back(static_cast<std::uint8_t>((arc->one_way ? 1u : 0u) | (arc->lanes << 1) |
+                                                      (arc->speed_class << 4)));
+        }
+    }
+
+    void finish() {
+        offsets.push_back(static_cast<std::uint32_t>(bytes.size()));
+        bytes.shrink_to_fit();
+    }
+
+    bool empty() const {
+        return offsets.empty();
+    }
+
+    ArcIterator arcs(std::uint32_t u) const {
+        return {bytes.data() + offsets[u], bytes.data() + offsets[u + 1], u};
+    }
+
+    std::size_t memory_bytes() const {
+        return offsets.size() * sizeof(std::uint32_t) + bytes.size();
+    }
+
+private:
+    void write_varint(std::uint64_t value) {
+        while (value >= 0x80) {
+            bytes.push_back(static_cast<std::uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        bytes.push_back(static_cast<std::uint8_t>(value));
+    }
+};
+
+
+#endif //HOMEWORK_GRAPH_COMPRESSED_ADJACENCY_H
@@ -10,6 +10,8 @@
 #include <cstring>
 #include <fstream>
 #include <cmath>
+#include <algorithm>
+#include <vector>
 
 // Color por defecto de todas las aristas (usado por SFML)
 sf::Color default_edge_color = sf::Color(255, 200, 100);
@@ -54,6 +56,7 @@ private:
 // Esta estructura contiene la informacion de una arista
 //
 // Variables miembro
+//     - index         : Posicion de la arista dentro de 'Graph::edges', asignada por 'Graph' al cargar
 //     - src           : Vértice inicial de la arista
 //     - dest          : Vértice final de la arista
 //     - max_speed     : Velocidad maxima en la que se puede ir de 'src' a 'dest'
@@ -61,21 +64,31 @@ private:
 //     - one_way       : Si es falso, significa que tambien existe una arista en el grafo de 'dest' a 'src'.
 //                       Caso contrario, significa que solo existe la arista actual de 'src' a 'dest'
 //     - lanes         : La cantidad de carriles en el camino de 'src' a 'dest'
+//     - shape         : Puntos intermedios de la trayectoria de 'src' a 'dest'. Solo las aristas creadas al
+//                       contraer cadenas de grado 2 (ver 'graph_simplifier.h') tienen puntos intermedios
+//     - via           : Ids de OSM de los vertices contraidos dentro de la arista, en orden de 'src' a 'dest'
+//     - via_offset    : Longitud desde 'src' hasta cada vertice de 'via' (ver 'Graph::anchor')
 //     - color         : El color de la linea que conecta a 'src' y 'dest', es usado por SFML
 //     - thickness     : El grosor de la linea que conecta a 'src' y 'dest', es usado por SFML
 //
 // Funciones miembro
 //     - parse_csv     : Lee las aristas desde el csv
 //     - draw          : Dibuja la arista instanciada
+//     - other         : Devuelve el extremo opuesto a 'node'
+//     - points_from   : Devuelve la trayectoria completa empezando por el extremo 'from'
 //     - reset         : Setea 'color' y 'thickness' a sus valores por defecto
 // *
 struct Edge {
+    std::size_t index = 0;
     Node *src = nullptr;
     Node *dest = nullptr;
     int max_speed;
     double length;
     bool one_way;
     int lanes;
+    std::vector<sf::Vector2f> shape;
+    std::vector<std::size_t> via;
+    std::vector<double> via_offset;
 
     sf::Color color = default_edge_color;
     float thickness = default_thickness;
@@ -90,9 +103,16 @@ struct Edge {
 
     static void
     parse_csv(const std::string &edges_path, std::vector<Edge *> &edges, std::map<std::size_t, Node *> &nodes) {
-        edges.reserve(790'509);
-
         std::ifstream file(edges_path);
+
+        // cada fila ocupa ~40 bytes; se reserva segun el tamaño del archivo en lugar de un numero fijo
+        file.seekg(0, std::ios::end);
+        std::streamoff file_size = file.tellg();
+        file.seekg(0, std::ios::beg);
+        if (file_size > 0) {
+            edges.reserve(edges.size() + static_cast<std::size_t>(file_size / 40) + 1);
+        }
+
         char *header = new char[50];
         header[49] = '\0';
         file.getline(header, 50, '\n');
@@ -128,8 +148,12 @@ struct Edge {
             std::size_t src_id = static_cast<size_t>(std::stoll(src));
             std::size_t dest_id = static_cast<size_t>(std::stoll(dest));
 
-            Node *src_node = nodes[src_id];
-            Node *dest_node = nodes[dest_id];
+            // Si el id no existe en nodes.csv el extremo queda en nullptr; 'Graph' descarta esas aristas.
+            // (find en lugar de operator[] para no insertar entradas nulas en 'nodes')
+            auto src_it = nodes.find(src_id);
+            auto dest_it = nodes.find(dest_id);
+            Node *src_node = src_it == nodes.end() ? nullptr : src_it->second;
+            Node *dest_node = dest_it == nodes.end() ? nullptr : dest_it->second;
 
             Edge *edge = new Edge(
                     src_node,
@@ -149,9 +173,33 @@ struct Edge {
         }
     }
 
+    Node *other(const Node *node) const {
+        return node == src ? dest : src;
+    }
+
+    std::vector<sf::Vector2f> points_from(const Node *from) const {
+        std::vector<sf::Vector2f> points;
+        points.reserve(shape.size() + 2);
+        points.push_back(src->coord);
+        points.insert(points.end(), shape.begin(), shape.end());
+        points.push_back(dest->coord);
+        if (from == dest) {
+            std::reverse(points.begin(), points.end());
+        }
+        return points;
+    }
+
     void draw(sf::RenderWindow &window) const {
-        sfLine line(src->coord, dest->coord, color, thickness);
-        line.draw(window, sf::RenderStates::Default);
+        if (shape.empty()) {
+            sfLine line(src->coord, dest->coord, color, thickness);
+            line.draw(window, sf::RenderStates::Default);
+            return;
+        }
+        std::vector<sf::Vector2f> points = points_from(src);
+        for (std::size_t i = 0; i + 1 < points.size(); ++i) {
+            sfLine line(points[i], points[i + 1], color, thickness);
+            line.draw(window, sf::RenderStates::Default);
+        }
     }
 };
 
@@ -0,0 +1,283 @@
+//
+// Created by juan-diego on 3/29/24.
+//
+
+#ifndef HOMEWORK_GRAPH_EXPLORATION_TRACE_H
+#define HOMEWORK_GRAPH_EXPLORATION_TRACE_H
+
+#include "window_manager.h"
+#include "edge.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <vector>
+
+
+// Tipo de un evento de la traza
+enum TraceEventType : std::uint8_t {
+    RelaxEvent,     // La busqueda mejoro la distancia del extremo de la arista
+    ReopenEvent     // ARA*: se mejoro un nodo ya cerrado, que vuelve a la cola en la siguiente ronda
+};
+
+
+// *
+// ---- TraceEvent ----
+// Un evento de la exploracion en 8 bytes: la arista ('Edge::index') y, empaquetados en la segunda palabra, el
+// paso de la busqueda (nodos procesados hasta ese momento, 30 bits) y el tipo (2 bits).
+// *
+struct TraceEvent {
+    std::uint32_t edge;
+    std::uint32_t packed;
+
+    TraceEvent(std::uint32_t edge, std::uint32_t step, TraceEventType type)
+            : edge(edge), packed(step << 2 | type) {}
+
+    std::uint32_t step() const {
+        return packed >> 2;
+    }
+
+    TraceEventType type() const {
+        return static_cast<TraceEventType>(packed & 3);
+    }
+};
+
+static_assert(sizeof(TraceEvent) == 8, "TraceEvent debe ocupar 8 bytes");
+
+
+// *
+// ---- ExplorationTrace ----
+// Aristas que visito una busqueda, en el orden en que las visito. Solo se guardan los eventos (8 bytes cada
+// uno); los vertices se generan en cada 'draw' siguiendo la forma de cada arista ('Edge::points_from') en un
+// sf::VertexArray de a lo sumo 'chunk_vertices' vertices, que se dibuja y se vacia cada vez que se llena. Asi
+// la memoria de dibujo queda acotada (~640 KiB) en lugar de crecer 4 vertices (80 bytes) por segmento, a
+// cambio de regenerar los vertices en cada frame. 'release_geometry' libera el buffer cuando la traza deja de
+// mostrarse.
+//
+// Variables miembro
+//     - color         : Color de los eventos 'RelaxEvent' (los 'ReopenEvent' van en rojo)
+//     - thickness     : Grosor de las lineas
+//
+// Funciones miembro
+//     - begin         : Vacia la traza, fija el estilo y reserva espacio para 'capacity' eventos
+//     - record        : Agrega un evento
+//     - save          : Guarda la traza en un archivo binario
+//     - load          : Lee una traza guardada con 'save' sobre un grafo con 'edge_count' aristas
+//     - draw          : Dibuja los primeros 'count' eventos
+//     - memory_bytes  : Memoria de los eventos mas la del buffer de vertices de 'draw'
+// *
+class ExplorationTrace {
+    static constexpr std::size_t chunk_vertices = 1u << 15;
+
+    std::vector<TraceEvent> events;
+    sf::VertexArray geometry {sf::Quads};
+    std::size_t geometry_peak = 0;  // mayor cantidad de vertices que tuvo 'geometry' desde 'release_geometry'
+
+    static constexpr char magic[4] = {'T', 'R', 'C', 'E'};
+    static constexpr std::uint32_t version = 2;
+
+public:
+    sf::Color color = sf::Color(100, 100, 255, 100);
+    float thickness = 1.0f;
+
+    void begin(sf::Color line_color, float line_thickness, std::size_t capacity) {
+        clear();
+        color = line_color;
+        thickness = line_thickness;
+        events.reserve(capacity);
+    }
+
+    void record(std::size_t edge, std::size_t step, TraceEventType type = RelaxEvent) {
+        events.emplace_back(static_cast<std::uint32_t>(edge), static_cast<std::uint32_t>(step), type);
+    }
+
+    // conserva la capacidad reservada para la siguiente busqueda
+    void clear() {
+        events.clear();
+        release_geometry();
+    }
+
+    // clear() conserva la capacidad del vector de vertices; se reemplaza para liberarla
+    void release_geometry() {
+        geometry = sf::VertexArray(sf::Quads);
+        geometry_peak = 0;
+    }
+
+    std::size_t size() const {
+        return events.size();
+    }
+
+    bool empty() const {
+        return events.empty();
+    }
+
+    const std::vector<TraceEvent> &data() const {
+        return events;
+    }
+
+    std::size_t memory_bytes() const {
+        return events.size() * sizeof(TraceEvent) + geometry_peak * sizeof(sf::Vertex);
+    }
+
+    //* --- save ---
+    // Formato (little-endian, como queda en memoria):
+    //     "TRCE" | version | aristas del grafo | fingerprint | color (rgba) | grosor | eventos | TraceEvent[eventos]
+    // Los eventos guardan 'Edge::index', asi que 'load' rechaza trazas de otro grafo ('Graph::fingerprint'
+    // distinto) y archivos cuyo 'eventos' no coincide con los bytes que quedan.
+    //*
+    bool save(const std::string &path, std::size_t edge_count, std::uint64_t fingerprint) const {
+        std::ofstream file(path, std::ios::binary);
+        if (!file) return false;
+
+        auto m = static_cast<std::uint32_t>(edge_count);
+        auto count = static_cast<std::uint64_t>(events.size());
+        std::uint8_t rgba[4] = {color.r, color.g, color.b, color.a};
+        file.write(magic, sizeof(magic));
+        file.write(reinterpret_cast<const char *>(&version), sizeof(version));
+        file.write(reinterpret_cast<const char *>(&m), sizeof(m));
+        file.write(reinterpret_cast<const char *>(&fingerprint), sizeof(fingerprint));
+        file.write(reinterpret_cast<const char *>(rgba), sizeof(rgba));
+        file.write(reinterpret_cast<const char *>(&thickness), sizeof(thickness));
+        file.write(reinterpret_cast<const char *>(&count), sizeof(count));
+        file.write(reinterpret_cast<const char *>(events.data()),
+                   static_cast<std::streamsize>(events.size() * sizeof(TraceEvent)));
+        return static_cast<bool>(file);
+    }
+
+    bool load(const std::string &path, std::size_t edge_count, std::uint64_t fingerprint) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) return false;
+
+        char header[4];
+        std::uint32_t file_version = 0, m = 0;
+        std::uint8_t rgba[4];
+        float file_thickness = 0.0f;
+        std::uint64_t file_fingerprint = 0, count = 0;
+        file.read(header, sizeof(header));
+        file.read(reinterpret_cast<char *>(&file_version), sizeof(file_version));
+        file.read(reinterpret_cast<char *>(&m), sizeof(m));
+        file.read(reinterpret_cast<char *>(&file_fingerprint), sizeof(file_fingerprint));
+        file.read(reinterpret_cast<char *>(rgba), sizeof(rgba));
+        file.read(reinterpret_cast<char *>(&file_thickness), sizeof(file_thickness));
+        file.read(reinterpret_cast<char *>(&count), sizeof(count));
+        if (!file || std::memcmp(header, magic, sizeof(magic)) != 0 || file_version != version ||
+            m != edge_count || file_fingerprint != fingerprint) {
+            return false;
+        }
+
+        // 'count' viene del archivo: se compara con lo que queda antes de reservar memoria para los eventos
+        std::streampos events_start = file.tellg();
+        file.seekg(0, std::ios::end);
+        std::streamoff remaining = file.tellg() - events_start;
+        file.seekg(events_start);
+        if (!file || remaining < 0 || count != static_cast<std::uint64_t>(remaining) / sizeof(TraceEvent) ||
+            static_cast<std::uint64_t>(remaining) % sizeof(TraceEvent) != 0) {
+            return false;
+        }
+
+        std::vector<TraceEvent> loaded(count, TraceEvent(0, 0, RelaxEvent));
+        file.read(reinterpret_cast<char *>(loaded.data()), static_cast<std::streamsize>(count * sizeof(TraceEvent)));
+        if (!file) return false;
+        for (const TraceEvent &event: loaded) {
+            if (event.edge >= edge_count) return false;
+        }
+
+        begin(sf::Color(rgba[0], rgba[1], rgba[2], rgba[3]), file_thickness, 0);
+        events = std::move(loaded);
+        return true;
+    }
+
+    //* --- draw ---
+    // Dibuja los eventos [0, count) con las aristas 'edges' (las de 'Graph::edges'), en tandas de
+    // 'chunk_vertices' vertices.
+    //*
+    void draw(WindowManager &window_manager, const std::vector<Edge *> &edges,
+              std::size_t count = std::numeric_limits<std::size_t>::max()) {
+        count = std::min(count, events.size());
+
+        static const sf::Color reopened(255, 60, 60, 140);
+        for (std::size_t i = 0; i < count; ++i) {
+            const TraceEvent &event = events[i];
+            const Edge *edge = edges[event.edge];
+            sf::Color line_color = event.type() == ReopenEvent ? reopened : color;
+
+            if (edge->shape.empty()) {
+                append_line(edge->src->coord, edge->dest->coord, line_color);
+            } else {
+                std::vector<sf::Vector2f> points = edge->points_from(edge->src);
+                for (std::size_t k = 1; k < points.size(); ++k) {
+                    append_line(points[k - 1], points[k], line_color);
+                }
+            }
+            if (geometry.getVertexCount() >= chunk_vertices) {
+                flush(window_manager);
+            }
+        }
+        flush(window_manager);
+    }
+
+private:
+    void flush(WindowManager &window_manager) {
+        if (geometry.getVertexCount() == 0) return;
+        geometry_peak = std::max(geometry_peak, geometry.getVertexCount());
+        window_manager.get_window().draw(geometry);
+        window_manager.record_draw(1, geometry.getVertexCount());
+        geometry.clear();
+    }
+
+    // mismo rectangulo que 'sfLine'
+    void append_line(sf::Vector2f p1, sf::Vector2f p2, sf::Color line_color) {
+        sf::Vector2f direction = p2 - p1;
+        float length = std::sqrt(direction.x * direction.x + direction.y * direction.y);
+        if (length == 0.0f) return;
+        sf::Vector2f offset = (thickness / 2.f / length) * sf::Vector2f(-direction.y, direction.x);
+
+        geometry.append(sf::Vertex(p1 + offset, line_color));
+        geometry.append(sf::Vertex(p2 + offset, line_color));
+        geometry.append(sf::Vertex(p2 - offset, line_color));
+        geometry.append(sf::Vertex(p1 - offset, line_color));
+    }
+};
+
+
+// *
+// ---- TraceReplay ----
+// Repeticion de una 'ExplorationTrace' en la GUI: cuantos eventos mostrar en cada frame.
+//
+// Variables miembro
+//     - playing       : Si la repeticion esta activa (pausada o no)
+//     - paused        : Si la posicion esta detenida
+//     - speed         : Eventos por segundo
+//
+// Funciones miembro
+//     - start         : Empieza desde el primer evento
+//     - advance       : Avanza segun el tiempo transcurrido y devuelve cuantos eventos mostrar; al llegar a
+//                       'total' la repeticion termina
+// *
+struct TraceReplay {
+    bool playing = false;
+    bool paused = false;
+    double speed = 2000.0;
+    double position = 0.0;
+
+    void start() {
+        playing = true;
+        paused = false;
+        position = 0.0;
+    }
+
+    std::size_t advance(double seconds, std::size_t total) {
+        if (!paused) position += speed * seconds;
+        if (position >= static_cast<double>(total)) {
+            playing = false;
+            return total;
+        }
+        return static_cast<std::size_t>(position);
+    }
+};
+
+
+#endif //HOMEWORK_GRAPH_EXPLORATION_TRACE_H
@@ -0,0 +1,118 @@
+//
+// Created by juan-diego on 3/29/24.
+//
+
+#ifndef HOMEWORK_GRAPH_FACILITY_SET_H
+#define HOMEWORK_GRAPH_FACILITY_SET_H
+
+#include "graph.h"
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+// *
+// ---- FacilitySet ----
+// Conjunto de nodos objetivo (hospitales, depositos, etc.) para las consultas al mas cercano
+// ('PathFindingManager::nearest' y el pedido "nearest" del servidor). Se carga de un csv en el que cada fila es
+//     - un id de OSM                      : 1000007. Si es un nodo de paso contraido al cargar se usa el extremo
+//                                           mas cercano de su arista por el que se llega a el ('Graph::anchor')
+//     - coordenadas en el orden de nodes.csv (y,x), que se ajustan al nodo mas cercano con 'Graph::nearest'
+//                                           (busqueda vectorizada con 'SimdKernels::nearest')
+//     - un nombre o id propio y las coordenadas: hospital_1,12.29,0.76
+// La primera fila se ignora si no es un id ni coordenadas (encabezado).
+//
+// Variables miembro
+//     - nodes         : 'Node::index' de los objetivos, sin repetir, en el orden del archivo
+//     - skipped       : Filas descartadas en la ultima carga (ids desconocidos o filas invalidas)
+//     - moved         : Ids de nodos de paso reemplazados por un extremo de su arista en la ultima carga
+//
+// Funciones miembro
+//     - load_csv      : Agrega los objetivos del archivo; false si no se pudo abrir
+//     - add           : Agrega un nodo si no estaba
+// *
+struct FacilitySet {
+    std::vector<std::uint32_t> nodes;
+    std::size_t skipped = 0;
+    std::size_t moved = 0;
+
+    bool load_csv(const std::string &path, Graph &graph) {
+        std::ifstream file(path);
+        if (!file) return false;
+
+        skipped = 0;
+        moved = 0;
+        std::string line;
+        bool first = true;
+        while (std::getline(file, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty()) continue;
+
+            std::vector<std::string> fields;
+            std::stringstream row(line);
+            for (std::string field; std::getline(row, field, ',');) fields.push_back(field);
+
+            Node *node = nullptr;
+            bool valid = parse_row(fields, graph, node, moved);
+            if (!valid && first) {
+                first = false;
+                continue;
+            }
+            first = false;
+
+            if (node == nullptr) {
+                skipped++;
+                continue;
+            }
+            add(static_cast<std::uint32_t>(node->index));
+        }
+        return true;
+    }
+
+    void add(std::uint32_t node) {
+        if (std::find(nodes.begin(), nodes.end(), node) == nodes.end()) nodes.push_back(node);
+    }
+
+    bool empty() const {
+        return nodes.empty();
+    }
+
+    std::size_t size() const {
+        return nodes.size();
+    }
+
+private:
+    // false si la fila no tiene el formato esperado; con formato valido 'node' queda en nullptr si el id no
+    // existe en el grafo
+    static bool parse_row(const std::vector<std::string> &fields, Graph &graph, Node *&node, std::size_t &moved) {
+        try {
+            std::size_t used = 0;
+            if (fields.size() == 1) {
+                std::size_t id = std::stoull(fields[0], &used);
+                if (used != fields[0].size()) return false;
+                NodeAnchor anchor;
+                if (graph.anchor(id, TargetAnchor, anchor)) {
+                    node = graph.node_at(anchor.nearest_end().node);
+                    if (anchor.contracted()) moved++;
+                }
+                return true;
+            }
+            if (fields.size() == 2 || fields.size() == 3) {
+                std::size_t first = fields.size() - 2;
+                float x = std::stof(fields[first]);
+                float y = std::stof(fields[first + 1]);
+                node = graph.nearest(sf::Vector2f(x, y));
+                return true;
+            }
+        } catch (const std::exception &) {
+            // 'std::stoull' / 'std::stof' no pudieron leer un numero
+        }
+        return false;
+    }
+};
+
+
+#endif //HOMEWORK_GRAPH_FACILITY_SET_H
@@ -9,7 +9,97 @@
 #include "window_manager.h"
 #include "node.h"
 #include "edge.h"
+#include "node_ordering.h"
+#include "simd_kernels.h"
+#include "adjacency.h"
+#include "arc_flags.h"
+#include "components.h"
+#include "graph_simplifier.h"
+#include "compressed_adjacency.h"
+#include "hub_labels.h"
+#include <algorithm>
 #include <iostream>
+#include <unordered_map>
+
+
+// Opciones de carga del grafo
+//     - order         : Orden en el que se guardan los vertices en memoria (ver 'node_ordering.h')
+//     - largest_component_only: Si es verdadero, 'nearest' solo devuelve nodos de la componente fuertemente
+//                       conexa mas grande, asi cualquier par de clicks tiene camino en ambos sentidos
+//     - simplify      : Si es verdadero, elimina aristas paralelas y contrae los nodos de paso (grado 2) al
+//                       cargar (ver 'graph_simplifier.h'). Las aristas invalidas se eliminan siempre
+//     - compress      : Si es verdadero, construye 'Graph::compressed' al cargar en lugar de en la primera
+//                       busqueda que lo necesite. No libera nada: para cargar solo la forma comprimida se usa
+//                       'CompactGraph' (ver 'compact_graph.h')
+//     - hub_labels_path: Archivo de donde 'build_hub_labels' carga las etiquetas y donde las guarda si tuvo que
+//                       calcularlas (vacio = no usar archivo)
+struct GraphLoadOptions {
+    NodeOrder order = HilbertOrder;
+    bool largest_component_only = false;
+    bool simplify = true;
+    bool compress = false;
+    std::string hub_labels_path = "hub_labels.bin";
+};
+
+
+// Papel de un id de OSM en una consulta: de un nodo de paso se sale por un extremo y se llega por el otro
+enum AnchorRole {
+    SourceAnchor,
+    TargetAnchor
+};
+
+
+// Extremo por el que un id de OSM entra al grafo: el nodo, la longitud desde el id hasta el nodo y los ids de
+// paso de ese tramo, en el orden del camino (de 'id' a 'node' en un origen, de 'node' a 'id' en un destino)
+struct AnchorEnd {
+    std::uint32_t node;
+    double offset;
+    std::vector<std::size_t> via;
+};
+
+
+// *
+// ---- NodeAnchor ----
+// Un id de OSM resuelto con 'Graph::anchor'. Un nodo del grafo tiene un solo extremo, el mismo, con longitud
+// 0. Un nodo de paso contraido (ver 'graph_simplifier.h') esta dentro de 'edge', a 'position' de su 'src', y
+// tiene un extremo por cada sentido en que se puede recorrer la arista desde el (origen) o hacia el (destino).
+// El costo de una consulta es el minimo entre los extremos de la distancia del grafo mas 'AnchorEnd::offset'.
+//
+// Funciones miembro
+//     - contracted    : true si el id es un nodo de paso
+//     - nearest_end   : Extremo con menor 'offset' (para las busquedas de un solo origen y destino)
+//     - wrap          : Completa un camino del grafo que empieza o termina en un extremo con el tramo hasta 'id'
+// *
+struct NodeAnchor {
+    std::size_t id = 0;
+    std::vector<AnchorEnd> ends;
+    const Edge *edge = nullptr;
+    std::size_t via_position = 0;
+    double position = 0.0;
+
+    bool contracted() const {
+        return edge != nullptr;
+    }
+
+    const AnchorEnd &nearest_end() const {
+        return *std::min_element(ends.begin(), ends.end(), [](const AnchorEnd &a, const AnchorEnd &b) {
+            return a.offset < b.offset;
+        });
+    }
+
+    // 'ids' empieza (origen) o termina (destino) en el id de 'end.node'
+    void wrap(const AnchorEnd &end, AnchorRole role, std::vector<std::size_t> &ids) const {
+        if (!contracted()) return;
+        if (role == SourceAnchor) {
+            std::vector<std::size_t> prefix {id};
+            prefix.insert(prefix.end(), end.via.begin(), end.via.end());
+            ids.insert(ids.begin(), prefix.begin(), prefix.end());
+        } else {
+            ids.insert(ids.end(), end.via.begin(), end.via.end());
+            ids.push_back(id);
+        }
+    }
+};
 
 
 // *
@@ -18,12 +108,36 @@
 // donde V es un conjunto de vertices y E un conjunto de aristas (a, b), donde a y b pertenecen a V.
 //
 // Variables miembro
-//     - nodes         : Todos los nodos de nuestro grafo
-//     - edges         : Todas las aristas de nuestro grafo
+//     - nodes         : Todos los nodos de nuestro grafo, indexados por su id de OSM. Junto con 'Node::id'
+//                       funciona como la tabla de traduccion entre ids de OSM e indices densos
+//     - edges         : Todas las aristas de nuestro grafo, ordenadas por el indice de su 'src'
+//     - node_storage  : Almacenamiento contiguo de los nodos; 'node_storage[i]' es el nodo con 'index' i
+//     - edge_storage  : Almacenamiento contiguo de las aristas, en el mismo orden que 'edges'
+//     - xs, ys        : Copia de 'coord' en formato SoA (indexada por 'Node::index') para los kernels SIMD
+//     - forward       : Adyacencia compacta (CSR) con los arcos que se pueden recorrer desde cada nodo
+//     - backward      : Adyacencia compacta con los arcos invertidos (para busquedas hacia atras)
+//     - arc_flags     : Banderas por region de cada arco de 'forward'; vacias hasta llamar 'build_arc_flags'
+//     - compressed    : Adyacencia comprimida (ver 'compressed_adjacency.h'); vacia hasta 'build_compressed'
+//     - hub_labels    : Oraculo de distancias (ver 'hub_labels.h'); vacio hasta 'build_hub_labels'
+//     - components    : Componentes fuerte y debilmente conexas (ver 'components.h')
+//     - contracted    : Id de OSM de cada nodo de paso contraido -> ('Edge::index', posicion en 'Edge::via')
+//     - options       : Opciones con las que se cargo el grafo
+//     - fingerprint   : Hash de la numeracion y de los arcos (ver 'reorder'); los archivos que dependen de la
+//                       numeracion ('hub_labels.h', 'exploration_trace.h') lo guardan y lo comparan al cargar
+//     - heuristic_scale: Mayor factor k tal que k * (distancia en linea recta) nunca supera 'Edge::length'.
+//                       Escalada por k, la heuristica en linea recta es admisible y consistente
 //     - window_manager: Se usa para que el grafo pueda dibujarse en el frame actual
 //
 // Funciones miembro
 //     - parse_csv     : Lee las aristas y vértices desde los csv
+//     - reorder       : Renumera los vertices en el orden pedido y reconstruye la adyacencia
+//     - node_at       : Devuelve el nodo con el indice denso 'index'
+//     - anchor        : Resuelve un id de OSM, tambien de un nodo de paso contraido (ver 'NodeAnchor')
+//     - along_edge    : Camino directo entre dos nodos de paso de la misma arista, sin salir de ella
+//     - nearest       : Devuelve el nodo mas cercano a un punto (busqueda exhaustiva vectorizada)
+//     - build_arc_flags: Particiona el grafo en 2^levels regiones y calcula las banderas de 'arc_flags'
+//     - build_compressed: Codifica 'forward' en 'compressed'
+//     - build_hub_labels: Carga 'hub_labels' de 'options.hub_labels_path' o las calcula y las guarda ahi
 //     - draw          : Dibuja las aristas y luego los vertices del grafo sobre la ventana
 //     - reset         : Restaura los colores de vértices y aristas a sus colores por defecto
 // *
@@ -31,30 +145,313 @@ struct Graph {
     WindowManager *window_manager;
     std::map<size_t, Node *> nodes;
     std::vector<Edge *> edges;
+    std::vector<Node> node_storage;
+    std::vector<Edge> edge_storage;
+    std::vector<float> xs;
+    std::vector<float> ys;
+    Adjacency forward;
+    Adjacency backward;
+    ArcFlags arc_flags;
+    CompressedAdjacency compressed;
+    HubLabels hub_labels;
+    Components components;
+    std::unordered_map<std::size_t, std::pair<std::uint32_t, std::uint32_t>> contracted;
+    GraphLoadOptions options;
+    std::uint64_t fingerprint = 0;
+    double heuristic_scale = 1.0;
 
     explicit Graph(WindowManager* window_manager): window_manager(window_manager) {}
 
-    void parse_csv(const std::string &nodes_path, const std::string &edges_path) {
+    void parse_csv(const std::string &nodes_path, const std::string &edges_path,
+                   const GraphLoadOptions &options = GraphLoadOptions()) {
+        this->options = options;
+
         Node::parse_csv(nodes_path, this->nodes);
         std::cout << "Cargado " << this->nodes.size() << " nodos" << std::endl;
         
         Edge::parse_csv(edges_path, this->edges, this->nodes);
         std::cout << "Cargado " << this->edges.size() << " aristas" << std::endl;
 
+        std::size_t invalid = GraphSimplifier::drop_invalid(this->edges);
+        if (invalid > 0) {
+            std::cout << "Descartadas " << invalid << " aristas con extremos inexistentes o lazos" << std::endl;
+        }
+        if (options.simplify) {
+            std::size_t duplicates = GraphSimplifier::drop_duplicates(this->edges);
+            std::size_t contracted = GraphSimplifier::contract_chains(this->nodes, this->edges);
+            std::cout << "Simplificado: " << duplicates << " aristas paralelas eliminadas, " << contracted
+                      << " nodos de paso contraidos (quedan " << this->nodes.size() << " nodos y "
+                      << this->edges.size() << " aristas)" << std::endl;
+        }
+
+        std::size_t index = 0;
+        for (auto &[_, node]: nodes) {
+            node->index = index++;
+        }
+        build_adjacency();
+
+        reorder(options.order);
+        if (options.compress) {
+            build_compressed();
+        }
+
+        std::cout << "Componentes fuertemente conexas: " << components.scc_size.size() << " (la mayor tiene "
+                  << (components.scc_size.empty() ? 0 : components.scc_size[components.largest]) << " nodos)"
+                  << std::endl;
+    }
+
+    //* --- reorder ---
+    // Los nodos vecinos en el mapa suelen tener ids de OSM muy distintos, por lo que en el orden original quedan
+    // lejos en memoria. Esta funcion copia nodos y aristas a 'node_storage' y 'edge_storage' siguiendo 'order',
+    // reasigna 'Node::index' / 'Edge::index', actualiza los punteros de 'nodes' y 'edges' y reconstruye la
+    // adyacencia. Los ids de OSM no cambian, asi que la entrada/salida sigue usando 'Node::id'.
+    //*
+    void reorder(NodeOrder order) {
+        std::vector<Node *> sequence = NodeReordering::compute(nodes, order);
+        for (std::size_t i = 0; i < sequence.size(); ++i) {
+            sequence[i]->index = i;
+        }
+
+        std::vector<Node> new_nodes;
+        new_nodes.reserve(sequence.size());
+        for (Node *node: sequence) {
+            new_nodes.push_back(*node);
+            new_nodes.back().edges.clear();
+        }
+
+        // las aristas de un mismo 'src' quedan juntas, en el orden de los nodos
+        std::vector<Edge *> sorted_edges = edges;
+        std::stable_sort(sorted_edges.begin(), sorted_edges.end(), [](Edge *a, Edge *b) {
+            if (a->src->index != b->src->index) return a->src->index < b->src->index;
+            return a->dest->index < b->dest->index;
+        });
+
+        std::vector<Edge> new_edges;
+        new_edges.reserve(sorted_edges.size());
+        for (Edge *edge: sorted_edges) {
+            new_edges.push_back(*edge);
+            Edge &copy = new_edges.back();
+            copy.index = new_edges.size() - 1;
+            copy.src = &new_nodes[edge->src->index];
+            copy.dest = &new_nodes[edge->dest->index];
+        }
+
+        // La primera vez los nodos y aristas vienen de 'parse_csv' (reservados con new)
+        if (node_storage.empty()) {
+            for (auto &[_, node]: nodes) delete node;
+            for (Edge *edge: edges) delete edge;
+        }
+        node_storage.swap(new_nodes);
+        edge_storage.swap(new_edges);
+
+        for (Node &node: node_storage) {
+            nodes[node.id] = &node;
+        }
+        edges.clear();
+        for (Edge &edge: edge_storage) {
+            edges.push_back(&edge);
+        }
+        build_adjacency();
+
+        contracted.clear();
+        for (Edge &edge: edge_storage) {
+            for (std::size_t i = 0; i < edge.via.size(); ++i) {
+                contracted[edge.via[i]] = {static_cast<std::uint32_t>(edge.index), static_cast<std::uint32_t>(i)};
+            }
+        }
+
+        forward = Adjacency::forward(node_storage.size(), edges);
+        backward = Adjacency::backward(node_storage.size(), edges);
+        // las banderas dependen de la numeracion anterior
+        arc_flags = ArcFlags();
+        compressed = CompressedAdjacency();
+        hub_labels = HubLabels();
+        components.build(forward);
+
+        xs.resize(node_storage.size());
+        ys.resize(node_storage.size());
+        for (Node &node: node_storage) {
+            xs[node.index] = node.coord.x;
+            ys[node.index] = node.coord.y;
+        }
+
+        largest_xs.clear();
+        largest_ys.clear();
+        largest_nodes.clear();
+        for (Node &node: node_storage) {
+            if (components.in_largest(node.index)) {
+                largest_xs.push_back(node.coord.x);
+                largest_ys.push_back(node.coord.y);
+                largest_nodes.push_back(static_cast<std::uint32_t>(node.index));
+            }
+        }
+
+        heuristic_scale = std::numeric_limits<double>::max();
         for (Edge *edge: edges) {
-            nodes[edge->src->id]->edges.push_back(edge);
-            if (!edge->one_way) {
-                nodes[edge->dest->id]->edges.push_back(edge);
+            sf::Vector2f delta = edge->dest->coord - edge->src->coord;
+            double straight = std::sqrt(delta.x * delta.x + delta.y * delta.y);
+            if (straight > 0.0) {
+                heuristic_scale = std::min(heuristic_scale, edge->length / straight);
             }
         }
+        if (heuristic_scale == std::numeric_limits<double>::max()) {
+            heuristic_scale = 1.0;
+        }
+
+        // FNV-1a sobre las opciones que cambian la numeracion, los ids de OSM en orden de 'index' y los arcos de
+        // 'forward' (destino, arista y longitud). Contar nodos y aristas no alcanza: otro csv del mismo tamaño, u
+        // otro 'order', produce indices distintos
+        fingerprint = 14695981039346656037ull;
+        hash(static_cast<std::uint32_t>(order));
+        hash(static_cast<std::uint32_t>(options.simplify));
+        for (const Node &node: node_storage) {
+            hash(static_cast<std::uint64_t>(node.id));
+        }
+        for (const Arc &arc: forward.arcs) {
+            hash(arc.to);
+            hash(arc.edge);
+            hash(arc.length);
+        }
+    }
+
+    Node *node_at(std::size_t index) {
+        return &node_storage[index];
+    }
+
+    //* --- anchor ---
+    // Un nodo del grafo se resuelve a si mismo. Un nodo de paso v de la arista u -> w (a distancia 'a' de u)
+    // sale hacia w con costo L - a y, si la arista es de doble sentido, tambien hacia u con costo a; como
+    // destino se llega desde u con costo a y, si es de doble sentido, desde w con costo L - a. false si el id
+    // no existe ni como nodo ni como nodo de paso.
+    //*
+    bool anchor(std::size_t id, AnchorRole role, NodeAnchor &out) const {
+        out = NodeAnchor();
+        out.id = id;
+        auto node = nodes.find(id);
+        if (node != nodes.end()) {
+            out.ends.push_back({static_cast<std::uint32_t>(node->second->index), 0.0, {}});
+            return true;
+        }
+        auto found = contracted.find(id);
+        if (found == contracted.end()) return false;
+
+        const Edge *edge = edges[found->second.first];
+        std::size_t i = found->second.second;
+        double a = edge->via_offset[i];
+        out.edge = edge;
+        out.via_position = i;
+        out.position = a;
+
+        // ids entre v y cada extremo, en orden desde v
+        std::vector<std::size_t> toward_dest(edge->via.begin() + static_cast<std::ptrdiff_t>(i) + 1, edge->via.end());
+        std::vector<std::size_t> toward_src(edge->via.rend() - static_cast<std::ptrdiff_t>(i), edge->via.rend());
+        auto src = static_cast<std::uint32_t>(edge->src->index), dest = static_cast<std::uint32_t>(edge->dest->index);
+
+        if (role == SourceAnchor) {
+            out.ends.push_back({dest, edge->length - a, toward_dest});
+            if (!edge->one_way) out.ends.push_back({src, a, toward_src});
+        } else {
+            std::reverse(toward_src.begin(), toward_src.end());
+            std::reverse(toward_dest.begin(), toward_dest.end());
+            out.ends.push_back({src, a, toward_src});
+            if (!edge->one_way) out.ends.push_back({dest, edge->length - a, toward_dest});
+        }
+        return true;
+    }
+
+    //* --- along_edge ---
+    // Si 'src' y 'dest' son nodos de paso de la misma arista y se puede ir de uno al otro sin salir de ella,
+    // devuelve true con el costo y los ids de ese tramo. El camino por el grafo puede ser igual o mas largo,
+    // pero nunca pasa por el tramo, asi que quien resuelve la consulta compara ambos.
+    //*
+    static bool along_edge(const NodeAnchor &src, const NodeAnchor &dest, double &cost, std::vector<std::size_t> &ids) {
+        if (!src.contracted() || src.edge != dest.edge) return false;
+        const Edge *edge = src.edge;
+        std::size_t i = src.via_position, j = dest.via_position;
+        if (j < i && edge->one_way) return false;
+
+        cost = std::abs(dest.position - src.position);
+        ids.clear();
+        if (i <= j) {
+            ids.assign(edge->via.begin() + static_cast<std::ptrdiff_t>(i), edge->via.begin() + static_cast<std::ptrdiff_t>(j) + 1);
+        } else {
+            for (std::size_t k = i + 1; k-- > j;) ids.push_back(edge->via[k]);
+        }
+        return true;
+    }
+
+    Node *nearest(sf::Vector2f point) {
+        if (options.largest_component_only) {
+            if (largest_nodes.empty()) return nullptr;
+            std::size_t i = SimdKernels::nearest(largest_xs.data(), largest_ys.data(), largest_xs.size(),
+                                                 point.x, point.y);
+            return node_at(largest_nodes[i]);
+        }
+        if (node_storage.empty()) return nullptr;
+        return node_at(SimdKernels::nearest(xs.data(), ys.data(), xs.size(), point.x, point.y));
+    }
+
+    void build_arc_flags(int levels = 5, unsigned threads = std::thread::hardware_concurrency()) {
+        arc_flags.build(forward, backward, xs, ys, levels, threads);
+        std::cout << "Arc flags: " << (1 << levels) << " regiones, " << arc_flags.boundary_nodes
+                  << " nodos frontera" << std::endl;
+    }
+
+    void build_compressed() {
+        compressed.build(forward, edges);
+        std::size_t csr_bytes = forward.offsets.size() * sizeof(std::uint32_t) + forward.arcs.size() * sizeof(Arc);
+        std::cout << "Adyacencia comprimida: " << compressed.memory_bytes() / 1024 << " KiB (CSR: "
+                  << csr_bytes / 1024 << " KiB, " << forward.arcs.size() << " arcos)" << std::endl;
+    }
+
+    void build_hub_labels(unsigned threads = std::thread::hardware_concurrency()) {
+        const std::string &path = options.hub_labels_path;
+        if (!path.empty() && hub_labels.load(path, node_storage.size(), edges.size(), fingerprint)) {
+            std::cout << "Hub labels cargadas de " << path << std::endl;
+        } else {
+            hub_labels.build(forward, backward, edges.size(), threads);
+            if (!path.empty()) {
+                std::cout << (hub_labels.save(path, fingerprint) ? "Hub labels guardadas en " : "No se pudo escribir ") << path
+                          << std::endl;
+            }
+        }
+        std::cout << "Hub labels: " << hub_labels.average_label() << " entradas por nodo, "
+                  << hub_labels.memory_bytes() / 1024 << " KiB" << std::endl;
     }
 
     void draw() {
+        std::size_t segments = 0;
         for (Edge *edge: edges) {
             edge->draw(window_manager->get_window());
+            segments += edge->shape.size() + 1;
         }
-        for (auto &[_, node]: nodes) {
-            node->draw(window_manager->get_window());
+        for (Node &node: node_storage) {
+            node.draw(window_manager->get_window());
+        }
+        window_manager->record_draw(segments, segments * 4);
+        window_manager->record_draw(node_storage.size(), node_storage.size() * WindowManager::circle_vertices());
+    }
+
+private:
+    // Coordenadas SoA de los nodos de la componente mas grande, para 'nearest' con 'largest_component_only'
+    std::vector<float> largest_xs;
+    std::vector<float> largest_ys;
+    std::vector<std::uint32_t> largest_nodes;
+
+    template<typename T>
+    void hash(const T &value) {
+        const auto *bytes = reinterpret_cast<const unsigned char *>(&value);
+        for (std::size_t i = 0; i < sizeof(T); ++i) {
+            fingerprint = (fingerprint ^ bytes[i]) * 1099511628211ull;
+        }
+    }
+
+    void build_adjacency() {
+        for (Edge *edge: edges) {
+            edge->src->edges.push_back(edge);
+            if (!edge->one_way) {
+                edge->dest->edges.push_back(edge);
+            }
         }
     }
 };
@@ -0,0 +1,166 @@
+//
+// Created by juan-diego on 3/29/24.
+//
+
+#ifndef HOMEWORK_GRAPH_GRAPH_SIMPLIFIER_H
+#define HOMEWORK_GRAPH_GRAPH_SIMPLIFIER_H
+
+#include "node.h"
+#include "edge.h"
+#include <algorithm>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+
+// *
+// ---- GraphSimplifier ----
+// Etapa de limpieza que corre al cargar, antes de numerar los nodos. OSM guarda cada punto de la forma de una
+// calle como un vertice, asi que la mayoria de nodos del dataset solo une dos aristas. Contraerlos reduce los
+// nodos (y las operaciones sobre el heap por consulta) sin cambiar las distancias entre los nodos restantes.
+//
+// Funciones miembro
+//     - drop_invalid      : Elimina aristas con algun extremo nulo (ids que no estan en nodes.csv) y lazos
+//     - drop_duplicates   : De las aristas paralelas con el mismo sentido deja solo la mas corta
+//     - contract_chains   : Reemplaza cada nodo de paso (grado 2) u - v - w por una arista u - w que conserva la
+//                           forma en 'Edge::shape', el id de v en 'Edge::via' y la longitud de u a v en
+//                           'Edge::via_offset', asi su id sigue sirviendo como origen o destino ('Graph::anchor')
+// Las tres devuelven cuantos elementos eliminaron. Los nodos y aristas eliminados se liberan con delete.
+// *
+struct GraphSimplifier {
+    static std::size_t drop_invalid(std::vector<Edge *> &edges) {
+        return remove_edges(edges, [](Edge *edge) {
+            return edge->src == nullptr || edge->dest == nullptr || edge->src == edge->dest;
+        });
+    }
+
+    static std::size_t drop_duplicates(std::vector<Edge *> &edges) {
+        // clave canonica: las aristas de doble sentido se guardan con el menor id primero
+        auto key = [](Edge *edge) {
+            std::size_t a = edge->src->id, b = edge->dest->id;
+            if (!edge->one_way && b < a) std::swap(a, b);
+            return std::make_tuple(a, b, edge->one_way);
+        };
+
+        std::map<std::tuple<std::size_t, std::size_t, bool>, Edge *> best;
+        for (Edge *edge: edges) {
+            auto [it, inserted] = best.insert({key(edge), edge});
+            if (!inserted && edge->length < it->second->length) it->second = edge;
+        }
+
+        // una arista de un solo sentido tambien sobra si hay una de doble sentido igual o mas corta
+        auto dominated = [&best](Edge *edge) {
+            std::size_t a = std::min(edge->src->id, edge->dest->id), b = std::max(edge->src->id, edge->dest->id);
+            auto it = best.find(std::make_tuple(a, b, false));
+            return it != best.end() && it->second->length <= edge->length;
+        };
+
+        return remove_edges(edges, [&](Edge *edge) {
+            if (best[key(edge)] != edge) return true;
+            return edge->one_way && dominated(edge);
+        });
+    }
+
+    static std::size_t contract_chains(std::map<std::size_t, Node *> &nodes, std::vector<Edge *> &edges) {
+        std::unordered_map<Node *, std::vector<Edge *>> incident;
+        for (Edge *edge: edges) {
+            incident[edge->src].push_back(edge);
+            incident[edge->dest].push_back(edge);
+        }
+
+        std::vector<Node *> worklist;
+        for (auto &[_, node]: nodes) worklist.push_back(node);
+
+        std::vector<Edge *> removed_edges;
+        std::size_t contracted = 0;
+
+        while (!worklist.empty()) {
+            Node *v = worklist.back();
+            worklist.pop_back();
+
+            auto found = incident.find(v);
+            if (found == incident.end() || found->second.size() != 2) continue;
+            Edge *e1 = found->second[0], *e2 = found->second[1];
+
+            // la arista que entra a v va primero
+            Node *u, *w;
+            bool one_way;
+            if (!e1->one_way && !e2->one_way) {
+                u = e1->other(v);
+                w = e2->other(v);
+                one_way = false;
+            } else if (e1->one_way && e2->one_way) {
+                if (e1->dest != v) std::swap(e1, e2);
+                if (e1->dest != v || e2->src != v) continue;  // v no es de paso: entran o salen ambas
+                u = e1->src;
+                w = e2->dest;
+                one_way = true;
+            } else {
+                continue;
+            }
+            if (u == w) continue;
+
+            auto *merged = new Edge(u, w, std::min(e1->max_speed, e2->max_speed), e1->length + e2->length, one_way,
+                                    std::min(e1->lanes, e2->lanes));
+            append_interior(e1, u, merged, 0.0);
+            merged->shape.push_back(v->coord);
+            merged->via.push_back(v->id);
+            merged->via_offset.push_back(e1->length);
+            append_interior(e2, v, merged, e1->length);
+
+            std::replace(incident[u].begin(), incident[u].end(), e1, merged);
+            std::replace(incident[w].begin(), incident[w].end(), e2, merged);
+            incident.erase(found);
+            edges.push_back(merged);
+            removed_edges.push_back(e1);
+            removed_edges.push_back(e2);
+
+            nodes.erase(v->id);
+            delete v;
+            contracted++;
+
+            worklist.push_back(u);
+            worklist.push_back(w);
+        }
+
+        std::sort(removed_edges.begin(), removed_edges.end());
+        remove_edges(edges, [&removed_edges](Edge *edge) {
+            return std::binary_search(removed_edges.begin(), removed_edges.end(), edge);
+        });
+        return contracted;
+    }
+
+private:
+    // agrega a 'merged' los puntos intermedios de 'edge' recorrida desde 'from'; 'start' es la longitud de
+    // 'merged' hasta 'from'
+    static void append_interior(Edge *edge, Node *from, Edge *merged, double start) {
+        if (edge->src == from) {
+            merged->shape.insert(merged->shape.end(), edge->shape.begin(), edge->shape.end());
+            merged->via.insert(merged->via.end(), edge->via.begin(), edge->via.end());
+            for (double offset: edge->via_offset) merged->via_offset.push_back(start + offset);
+        } else {
+            merged->shape.insert(merged->shape.end(), edge->shape.rbegin(), edge->shape.rend());
+            merged->via.insert(merged->via.end(), edge->via.rbegin(), edge->via.rend());
+            for (auto it = edge->via_offset.rbegin(); it != edge->via_offset.rend(); ++it) {
+                merged->via_offset.push_back(start + edge->length - *it);
+            }
+        }
+    }
+
+    template<typename Predicate>
+    static std::size_t remove_edges(std::vector<Edge *> &edges, Predicate remove) {
+        std::size_t before = edges.size();
+        auto keep_end = std::stable_partition(edges.begin(), edges.end(), [&remove](Edge *edge) {
+            return !remove(edge);
+        });
+        for (auto it = keep_end; it != edges.end(); ++it) {
+            delete *it;
+        }
+        edges.erase(keep_end, edges.end());
+        return before - edges.size();
+    }
+};
+
+
+#endif //HOMEWORK_GRAPH_GRAPH_SIMPLIFIER_H
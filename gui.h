@@ -8,9 +8,10 @@
 
 #include "window_manager.h"
 #include "path_finding_manager.h"
+#include "hud.h"
+#include "facility_set.h"
 
-#include <cmath>
-#include <functional>
+#include <chrono>
 #include <iostream>
 
 
@@ -19,45 +20,72 @@ class GUI {
     PathFindingManager path_finding_manager;
 
     Graph graph;
+    Hud hud;
+
+    // Limites de cada busqueda lanzada desde la GUI (por defecto sin limite) y la bandera que se activa con Escape
+    SearchBudget search_budget;
+    CancellationToken cancellation;
+
+    // Repeticion de la traza de la ultima busqueda (o de una cargada de 'trace_path')
+    TraceReplay replay;
+    const std::string trace_path = "exploration_trace.bin";
+
+    // Objetivos de la consulta al mas cercano (tecla T), marcados en rojo
+    FacilitySet facilities;
+
+    void mark_facilities() {
+        for (std::uint32_t index: facilities.nodes) {
+            Node *node = graph.node_at(index);
+            node->color = sf::Color::Red;
+            node->radius = 2.5f;
+        }
+    }
+
+    void run(Algorithm algorithm) {
+        cancellation.reset();
+        path_finding_manager.exec(graph, algorithm, search_budget, &cancellation);
+    }
 
     // 1NN es un algoritmo muy popular que retorna el 1 Nearest Neighbour (de ahí el nombre 1NN), o vecino más cercano
     // de una coleccion de elementos a una query dada.
     // En este caso, nos interesa conocer cuál es el nodo mas cercano al punto 'query' pasado como parámetro.
-    static Node *_1NN(std::map<std::size_t, Node *> &nodes, sf::Vector2i query) {
-        Node *nearest = nullptr;
-        double min_dist = std::numeric_limits<double>::max();
-        std::function<double(sf::Vector2f)> euclidean = [&](sf::Vector2f point) {
-            return std::sqrt(
-                    std::pow((point.x - (double) query.x), 2) + std::pow((point.y - (double) query.y), 2)
-            );
-        };
-
-        for (auto &[_, node]: nodes) {
-            double dist = euclidean(node->coord);
-            if (dist < min_dist) {
-                min_dist = dist;
-                nearest = node;
-            }
-        }
-
-        return nearest;
+    // El recorrido exhaustivo se hace con 'SimdKernels::nearest' sobre las coordenadas SoA del grafo.
+    static Node *_1NN(Graph &graph, sf::Vector2i query) {
+        return graph.nearest(sf::Vector2f(static_cast<float>(query.x), static_cast<float>(query.y)));
     }
 
 public:
 
-    explicit GUI(const std::string &nodes_path, const std::string &edges_path)
+    // 'frame_rate_limit' = 0 desactiva el limite de fps (util para medir con el HUD cuanto cuesta un frame)
+    // 'facilities_path' es el csv de objetivos de la tecla T (ver 'facility_set.h'); vacio = sin objetivos
+    explicit GUI(const std::string &nodes_path, const std::string &edges_path, unsigned frame_rate_limit = 200,
+                 const std::string &facilities_path = "")
             : path_finding_manager(&window_manager), graph(&window_manager) {
         // Parsea los nodos y aristas leyendolos a partir del csv
         graph.parse_csv(nodes_path, edges_path);
+        if (!facilities_path.empty()) {
+            if (facilities.load_csv(facilities_path, graph)) {
+                std::cout << "Cargados " << facilities.size() << " objetivos (" << facilities.skipped
+                          << " filas descartadas, " << facilities.moved << " nodos de paso movidos a un extremo de "
+                          << "su calle)" << std::endl;
+                mark_facilities();
+            } else {
+                std::cout << "No se pudo leer " << facilities_path << std::endl;
+            }
+        }
         // Para fines de la animación, puede variar dependiendo del computador
-        window_manager.get_window().setFramerateLimit(200);
+        window_manager.get_window().setFramerateLimit(frame_rate_limit);
+        hud.frame_rate_limit = frame_rate_limit;
     }
 
     void main_loop() {
         bool draw_extra_lines = false;
+        auto last_frame = std::chrono::steady_clock::now();
 
         // Corre la GUI siempre y cuando la ventana esté abierta
         while (window_manager.is_open()) {
+            hud.profiler.begin_frame();
+
             // Verifica los eventos de la ventana que pueden ser 'triggereados' (lanzados) por el usuario en la
             // iteración actual
             sf::Event event{};
@@ -78,28 +106,109 @@ public:
                             // D = Ejecutar Dijkstra
                             case sf::Keyboard::D: {
                                 std::cout << "Ejecutando Dijkstra..." << std::endl;
-                                path_finding_manager.exec(graph, Dijkstra);
+                                run(Dijkstra);
                                 std::cout << "Dijkstra culminado!" << std::endl;
                                 break;
                             }
                             // A = Ejecutar AStar
                             case sf::Keyboard::A: {
                                 std::cout << "Ejecutando A*..." << std::endl;
-                                path_finding_manager.exec(graph, AStar);
+                                run(AStar);
                                 std::cout << "A* culminado!" << std::endl;
                                 break;
                             }
                             // B = Ejecutar Best-First Search
                             case sf::Keyboard::B: {
                                 std::cout << "Ejecutando Best-First Search" << std::endl;
-                                path_finding_manager.exec(graph, BestFirstSearch);
+                                run(BestFirstSearch);
                                 std::cout << "Best-First Search culminado!" << std::endl;
                                 break;
                             }
+                            // F = Ejecutar Dijkstra con arc flags (la primera vez calcula las banderas)
+                            case sf::Keyboard::F: {
+                                std::cout << "Ejecutando Dijkstra con arc flags..." << std::endl;
+                                run(ArcFlagsDijkstra);
+                                std::cout << "Dijkstra con arc flags culminado!" << std::endl;
+                                break;
+                            }
+                            // Z = Ejecutar Dijkstra sobre la adyacencia comprimida
+                            case sf::Keyboard::Z: {
+                                std::cout << "Ejecutando Dijkstra comprimido..." << std::endl;
+                                run(CompressedDijkstra);
+                                std::cout << "Dijkstra comprimido culminado!" << std::endl;
+                                break;
+                            }
+                            // H = Distancia por hub labels (la primera vez las carga de 'hub_labels.bin' o las calcula)
+                            case sf::Keyboard::H: {
+                                std::cout << "Ejecutando consulta por hub labels..." << std::endl;
+                                run(HubLabelQuery);
+                                std::cout << "Consulta por hub labels culminada!" << std::endl;
+                                break;
+                            }
+                            // W = Ejecutar A* ponderado, con costo <= (1 + epsilon) * optimo
+                            case sf::Keyboard::W: {
+                                std::cout << "Ejecutando A* ponderado..." << std::endl;
+                                run(WeightedAStar);
+                                std::cout << "A* ponderado culminado!" << std::endl;
+                                break;
+                            }
+                            // N = Ejecutar ARA* (A* anytime), mejora la solucion hasta el optimo o hasta Escape
+                            case sf::Keyboard::N: {
+                                std::cout << "Ejecutando ARA*..." << std::endl;
+                                run(AnytimeAStar);
+                                std::cout << "ARA* culminado!" << std::endl;
+                                break;
+                            }
+                            // L = Hasta 3 rutas alternativas (la optima en amarillo), con una busqueda hacia
+                            //     adelante y otra hacia atras
+                            case sf::Keyboard::L: {
+                                std::cout << "Buscando rutas alternativas..." << std::endl;
+                                path_finding_manager.alternatives(graph);
+                                std::cout << path_finding_manager.last_routes().size() << " rutas encontradas" << std::endl;
+                                break;
+                            }
+                            // T = Ruta desde 'src' al objetivo mas cercano; Shift+T = a los 3 mas cercanos. Una
+                            //     sola busqueda, no hace falta elegir 'dest'
+                            case sf::Keyboard::T: {
+                                if (facilities.empty() || path_finding_manager.src == nullptr) {
+                                    std::cout << "Se necesita un origen y un csv de objetivos (--facilities)" << std::endl;
+                                    break;
+                                }
+                                std::size_t k = event.key.shift ? 3 : 1;
+                                cancellation.reset();
+                                path_finding_manager.nearest(graph, facilities.nodes, k, search_budget, &cancellation);
+                                std::cout << path_finding_manager.last_routes().size() << " objetivos encontrados" << std::endl;
+                                break;
+                            }
+                            // + / - = Duplica o reduce a la mitad el epsilon de A* ponderado y ARA*
+                            case sf::Keyboard::Add:
+                            case sf::Keyboard::Equal: {
+                                path_finding_manager.epsilon *= 2.0;
+                                path_finding_manager.anytime_epsilon *= 2.0;
+                                std::cout << "epsilon = " << path_finding_manager.epsilon << std::endl;
+                                break;
+                            }
+                            case sf::Keyboard::Subtract:
+                            case sf::Keyboard::Hyphen: {
+                                path_finding_manager.epsilon /= 2.0;
+                                path_finding_manager.anytime_epsilon /= 2.0;
+                                std::cout << "epsilon = " << path_finding_manager.epsilon << std::endl;
+                                break;
+                            }
+                            // C = Alterna si los clicks solo seleccionan nodos de la componente fuertemente conexa
+                            //     mas grande (asi siempre existe camino entre 'src' y 'dest')
+                            case sf::Keyboard::C: {
+                                graph.options.largest_component_only = !graph.options.largest_component_only;
+                                std::cout << "Solo componente mas grande: "
+                                          << (graph.options.largest_component_only ? "si" : "no") << std::endl;
+                                break;
+                            }
+                            // Escape = Mientras un algoritmo esta corriendo, lo aborta (ver 'PathFindingManager::render')
                             // R = Limpia la ultima simulación realizada.
                             //     También restaura los valores de 'src' y 'dest' a nullptr.
                             case sf::Keyboard::R: {
                                 path_finding_manager.reset();
+                                mark_facilities();
                                 break;
                             }
                             // E = Extra flag. Si es verdadero, hace un display de todos los 'edges'
@@ -108,6 +217,60 @@ public:
                                 draw_extra_lines = !draw_extra_lines;
                                 break;
                             }
+                            // V = Repite la exploracion de la ultima busqueda desde el inicio; si ya se esta
+                            //     repitiendo, la pausa o la reanuda
+                            case sf::Keyboard::V: {
+                                if (replay.playing) {
+                                    replay.paused = !replay.paused;
+                                } else {
+                                    replay.start();
+                                }
+                                break;
+                            }
+                            // , / . = Reduce a la mitad o duplica la velocidad de la repeticion
+                            case sf::Keyboard::Comma: {
+                                replay.speed = std::max(1.0, replay.speed / 2.0);
+                                std::cout << "Repeticion: " << replay.speed << " eventos/s" << std::endl;
+                                break;
+                            }
+                            case sf::Keyboard::Period: {
+                                replay.speed *= 2.0;
+                                std::cout << "Repeticion: " << replay.speed << " eventos/s" << std::endl;
+                                break;
+                            }
+                            // S = Guarda la traza de la ultima busqueda en 'trace_path'
+                            case sf::Keyboard::S: {
+                                ExplorationTrace &trace = path_finding_manager.exploration();
+                                bool saved = trace.save(trace_path, graph.edges.size(), graph.fingerprint);
+                                std::cout << (saved ? "Traza de exploracion guardada en " : "No se pudo escribir ")
+                                          << trace_path << " (" << trace.size() << " eventos)" << std::endl;
+                                break;
+                            }
+                            // O = Carga la traza de 'trace_path' (debe ser del mismo grafo) y la repite
+                            case sf::Keyboard::O: {
+                                path_finding_manager.reset();
+                                mark_facilities();
+                                ExplorationTrace &trace = path_finding_manager.exploration();
+                                if (trace.load(trace_path, graph.edges.size(), graph.fingerprint)) {
+                                    std::cout << "Traza cargada: " << trace.size() << " eventos" << std::endl;
+                                    replay.start();
+                                } else {
+                                    std::cout << "No se pudo cargar " << trace_path << std::endl;
+                                }
+                                break;
+                            }
+                            // I = Muestra u oculta el HUD (tiempos por frame, draw calls, ultima busqueda)
+                            case sf::Keyboard::I: {
+                                hud.toggle();
+                                break;
+                            }
+                            // P = Guarda la traza de los ultimos frames en 'frame_trace.csv'
+                            case sf::Keyboard::P: {
+                                bool saved = hud.dump("frame_trace.csv");
+                                std::cout << (saved ? "Traza guardada en " : "No se pudo escribir ")
+                                          << "frame_trace.csv" << std::endl;
+                                break;
+                            }
                             // Q = Quit, misma funcionalidad que cerrar la ventana
                             case sf::Keyboard::Q: {
                                 window_manager.close();
@@ -131,7 +294,7 @@ public:
                         // Si no existe un nodo fuente ('src') asignado
                         if (path_finding_manager.src == nullptr) {
                             // Encuentra el vértice más cercano a la posición del mouse y asigna el vértice a 'src'
-                            path_finding_manager.src = _1NN(graph.nodes, mouse_position);
+                            path_finding_manager.src = _1NN(graph, mouse_position);
                             path_finding_manager.src->color = sf::Color::Green;
                             path_finding_manager.src->radius = 3.0f;
                             std::cout << "Source node seleccionado: " << path_finding_manager.src->id << std::endl;
@@ -139,7 +302,7 @@ public:
                         // Si no existe un nodo destino ('dest') asignado
                         else if (path_finding_manager.dest == nullptr) {
                             // Encuentra el vértice más cercano a la posición del mouse y asigna el vértice a 'dest'
-                            path_finding_manager.dest = _1NN(graph.nodes, mouse_position);
+                            path_finding_manager.dest = _1NN(graph, mouse_position);
                             path_finding_manager.dest->color = sf::Color::Cyan;
                             path_finding_manager.dest->radius = 3.0f;
                             std::cout << "Destination node seleccionado: " << path_finding_manager.dest->id << std::endl;
@@ -154,17 +317,36 @@ public:
                 }
             }
 
+            hud.profiler.end_phase(EventsPhase);
+
             // Limpia la ventana anterior
             window_manager.clear();
 
             // Dibuja el grafo en el frame actual
             graph.draw();
+            hud.profiler.end_phase(GraphPhase);
             // Dibuja el 'path' resultante de la simulacion,
-            // si 'extra_lines' es true, también dibujará el resto de aristas visitadas
-            path_finding_manager.draw(draw_extra_lines);
+            // si 'extra_lines' es true, también dibujará el resto de aristas visitadas. Durante una
+            // repeticion se dibujan solo los eventos alcanzados hasta este frame.
+            auto now = std::chrono::steady_clock::now();
+            double seconds = std::chrono::duration<double>(now - last_frame).count();
+            last_frame = now;
+            if (replay.playing) {
+                std::size_t shown = replay.advance(seconds, path_finding_manager.exploration().size());
+                path_finding_manager.draw(graph, true, shown);
+            } else {
+                path_finding_manager.draw(graph, draw_extra_lines);
+            }
+            hud.profiler.end_phase(PathPhase);
+
+            // Dibuja el HUD encima de todo, con los tiempos de los frames anteriores
+            hud.draw(window_manager, path_finding_manager.last_stats());
+            hud.profiler.end_phase(HudPhase);
 
             // Hace un display del frame actual
             window_manager.display();
+            hud.profiler.end_phase(DisplayPhase);
+            hud.profiler.end_frame(window_manager.last_frame());
         }
     }
 };
@@ -0,0 +1,489 @@
+//
+// Created by juan-diego on 3/29/24.
+//
+
+#ifndef HOMEWORK_GRAPH_HUB_LABELS_H
+#define HOMEWORK_GRAPH_HUB_LABELS_H
+
+#include "adjacency.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <queue>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// *
+// ---- HubLabels ----
+// Oraculo de distancias por etiquetas de hubs. Cada nodo v guarda dos listas ordenadas por hub:
+//     - out(v)        : pares (h, dist(v -> h))
+//     - in(v)         : pares (h, dist(h -> v))
+// de forma que para todo par (s, t) con camino, algun hub comun a out(s) e in(t) esta en un camino minimo. La
+// distancia sale de mezclar ambas listas: dist(s, t) = min sobre hubs comunes de out(s).dist + in(t).dist, sin
+// recorrer el grafo (unas decenas o cientos de comparaciones, microsegundos).
+//
+// Construccion (pruned landmark labeling): los nodos se procesan en orden de importancia y desde cada hub h se
+// corre un Dijkstra hacia adelante y otro hacia atras que se podan en v cuando las etiquetas ya existentes dan
+// una distancia h -> v (o v -> h) igual o menor. La importancia se estima contando, en arboles de caminos
+// minimos desde nodos al azar, cuantos caminos pasan por cada nodo (los nodos de avenidas quedan primero).
+// Los hubs se procesan en lotes en paralelo: dentro de un lote las busquedas solo se podan con las etiquetas
+// de lotes anteriores, lo que agrega algunas etiquetas de sobra pero no cambia las distancias.
+//
+// Cada entrada guarda ademas la arista por la que su busqueda llego al nodo ('parent'), suficiente para
+// reconstruir el camino siguiendo las etiquetas del mismo hub hasta llegar a el.
+//
+// Las distancias se guardan como float (entrada de 12 bytes: hub, distancia y arista). Para un dataset del
+// tamaño de Lima el error es de milimetros.
+//
+// Funciones miembro
+//     - build         : Calcula el orden y las etiquetas con 'threads' hilos
+//     - empty         : true si aun no hay etiquetas
+//     - distance      : Distancia de u a v (infinito si no hay camino)
+//     - unpack        : Nodos y aristas del camino minimo de u a v
+//     - save / load   : Archivo binario con el orden y las etiquetas (ver 'save')
+//     - memory_bytes  : Memoria de las etiquetas
+//     - average_label : Promedio de entradas de out(v) + in(v)
+// *
+class HubLabels {
+    struct Labels {
+        std::vector<std::uint32_t> offsets;
+        std::vector<std::uint32_t> hubs;     // rango del hub (posicion en 'order')
+        std::vector<float> dists;
+        std::vector<std::uint32_t> parents;  // 'Edge::index' hacia el hub
+    };
+
+    struct Entry {
+        std::uint32_t hub;
+        float dist;
+        std::uint32_t parent;
+    };
+
+    static constexpr std::uint32_t no_edge = std::numeric_limits<std::uint32_t>::max();
+    static constexpr char magic[4] = {'H', 'U', 'B', 'L'};
+    static constexpr std::uint32_t version = 2;
+
+    std::vector<std::uint32_t> order;  // rango -> 'Node::index'
+    Labels out;
+    Labels in;
+    std::uint32_t edge_count = 0;
+
+public:
+    static constexpr double infinity = std::numeric_limits<double>::max();
+
+    void build(const Adjacency &forward, const Adjacency &backward, std::size_t edges,
+               unsigned threads = std::thread::hardware_concurrency()) {
+        threads = std::max(1u, threads);
+        std::size_t n = forward.node_count();
+        edge_count = static_cast<std::uint32_t>(edges);
+
+        order = importance_order(forward, threads);
+
+        std::vector<std::vector<Entry>> out_build(n), in_build(n);
+
+        // cada hilo corre las dos busquedas podadas de un hub y deja sus entradas en 'found'
+        struct Found {
+            std::vector<std::pair<std::uint32_t, Entry>> out;
+            std::vector<std::pair<std::uint32_t, Entry>> in;
+        };
+        std::vector<Scratch> scratch(threads, Scratch(n));
+
+        std::size_t next = 0;
+        while (next < n) {
+            // los primeros hubs cubren casi todo: lotes chicos al inicio, mas grandes despues
+            std::size_t batch = std::min(n - next, std::max<std::size_t>(threads, next / 64));
+            std::vector<Found> found(batch);
+            std::atomic<std::size_t> cursor {0};
+
+            auto work = [&](unsigned t) {
+                for (std::size_t i; (i = cursor++) < batch;) {
+                    auto r = static_cast<std::uint32_t>(next + i);
+                    pruned_search(forward, r, order[r], out_build, in_build, scratch[t], found[i].in);
+                    pruned_search(backward, r, order[r], in_build, out_build, scratch[t], found[i].out);
+                }
+            };
+            if (batch == 1 || threads == 1) {
+                work(0);
+            } else {
+                std::vector<std::thread> workers;
+                for (unsigned t = 0; t < std::min<std::size_t>(threads, batch); ++t) {
+                    workers.emplace_back(work, t);
+                }
+                for (std::thread &worker: workers) worker.join();
+            }
+
+            // en orden de rango, asi cada lista queda ordenada por hub
+            for (Found &f: found) {
+                for (auto &[v, entry]: f.out) out_build[v].push_back(entry);
+                for (auto &[v, entry]: f.in) in_build[v].push_back(entry);
+            }
+            next += batch;
+        }
+
+        flatten(out_build, out);
+        flatten(in_build, in);
+    }
+
+    bool empty() const {
+        return order.empty();
+    }
+
+    double distance(std::uint32_t u, std::uint32_t v) const {
+        return best_hub(u, v).second;
+    }
+
+    //* --- unpack ---
+    // Llena 'nodes' (de u a v) y 'edges' (edges[i] une nodes[i] con nodes[i + 1]) con un camino minimo. Necesita
+    // 'Graph::edges' para pasar de una arista al nodo siguiente. Devuelve false si no hay camino.
+    //*
+    template<typename EdgeList>
+    bool unpack(std::uint32_t u, std::uint32_t v, const EdgeList &graph_edges, std::vector<std::uint32_t> &nodes,
+                std::vector<std::uint32_t> &edges) const {
+        nodes.clear();
+        edges.clear();
+        auto [hub, dist] = best_hub(u, v);
+        if (dist == infinity) return false;
+        std::uint32_t hub_node = order[hub];
+
+        // u -> hub siguiendo out(u)
+        nodes.push_back(u);
+        for (std::uint32_t current = u; current != hub_node;) {
+            std::uint32_t edge = parent_of(out, current, hub);
+            current = other_end(graph_edges[edge], current);
+            edges.push_back(edge);
+            nodes.push_back(current);
+        }
+
+        // hub -> v siguiendo in(v) desde v hacia atras
+        std::vector<std::uint32_t> tail_nodes, tail_edges;
+        for (std::uint32_t current = v; current != hub_node;) {
+            std::uint32_t edge = parent_of(in, current, hub);
+            tail_nodes.push_back(current);
+            tail_edges.push_back(edge);
+            current = other_end(graph_edges[edge], current);
+        }
+        nodes.insert(nodes.end(), tail_nodes.rbegin(), tail_nodes.rend());
+        edges.insert(edges.end(), tail_edges.rbegin(), tail_edges.rend());
+        return true;
+    }
+
+    //* --- save ---
+    // Formato (enteros en el orden de bytes de la maquina):
+    //     "HUBL" | version | nodos | aristas | fingerprint | order[nodos] | out | in
+    // donde cada lista es offsets[nodos + 1] | hubs[k] | dists[k] | parents[k]. Las etiquetas dependen de la
+    // numeracion de los nodos y aristas, asi que 'load' rechaza archivos con otro 'Graph::fingerprint' (otro
+    // csv, otro 'NodeOrder' u otra simplificacion), aunque tengan la misma cantidad de nodos y aristas.
+    //*
+    bool save(const std::string &path, std::uint64_t fingerprint) const {
+        std::ofstream file(path, std::ios::binary);
+        if (!file) return false;
+
+        auto n = static_cast<std::uint32_t>(order.size());
+        file.write(magic, sizeof(magic));
+        write(file, version);
+        write(file, n);
+        write(file, edge_count);
+        write(file, fingerprint);
+        write_vector(file, order);
+        for (const Labels *labels: {&out, &in}) {
+            write_vector(file, labels->offsets);
+            write_vector(file, labels->hubs);
+            write_vector(file, labels->dists);
+            write_vector(file, labels->parents);
+        }
+        return static_cast<bool>(file);
+    }
+
+    bool load(const std::string &path, std::size_t node_count, std::size_t edges, std::uint64_t fingerprint) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) return false;
+
+        char header[4];
+        std::uint32_t file_version = 0, n = 0, m = 0;
+        std::uint64_t file_fingerprint = 0;
+        file.read(header, sizeof(header));
+        read(file, file_version);
+        read(file, n);
+        read(file, m);
+        read(file, file_fingerprint);
+        if (!file || std::memcmp(header, magic, sizeof(magic)) != 0 || file_version != version ||
+            n != node_count || m != edges || file_fingerprint != fingerprint) {
+            return false;
+        }
+
+        // 'read_vector' compara cada cantidad con los bytes que quedan antes de reservar memoria, y 'valid'
+        // revisa los rangos que 'distance' y 'unpack' usan como indices
+        HubLabels loaded;
+        loaded.edge_count = m;
+        bool ok = read_vector(file, loaded.order, n);
+        for (Labels *labels: {&loaded.out, &loaded.in}) {
+            ok = ok && read_vector(file, labels->offsets, n + 1) && valid_offsets(labels->offsets);
+            std::size_t k = ok ? labels->offsets.back() : 0;
+            ok = ok && read_vector(file, labels->hubs, k) && read_vector(file, labels->dists, k) &&
+                 read_vector(file, labels->parents, k);
+        }
+        if (!ok || !loaded.valid()) return false;
+
+        *this = std::move(loaded);
+        return true;
+    }
+
+    std::size_t memory_bytes() const {
+        std::size_t bytes = order.size() * sizeof(std::uint32_t);
+        for (const Labels *labels: {&out, &in}) {
+            bytes += labels->offsets.size() * sizeof(std::uint32_t) +
+                     labels->hubs.size() * (2 * sizeof(std::uint32_t) + sizeof(float));
+        }
+        return bytes;
+    }
+
+    double average_label() const {
+        if (order.empty()) return 0.0;
+        return static_cast<double>(out.hubs.size() + in.hubs.size()) / static_cast<double>(order.size());
+    }
+
+private:
+    // Arreglos de una busqueda podada, reutilizados entre hubs por el mismo hilo
+    struct Scratch {
+        std::vector<double> dist;
+        std::vector<std::uint32_t> parent;
+        std::vector<double> hub_dist;  // distancias de las etiquetas del hub actual, indexadas por rango
+        std::vector<std::uint32_t> touched;
+
+        explicit Scratch(std::size_t n) : dist(n, infinity), parent(n, no_edge), hub_dist(n, infinity) {}
+    };
+
+    //* --- pruned_search ---
+    // Dijkstra desde el hub de rango 'r' sobre 'adjacency'. Hacia adelante (adjacency = forward) produce
+    // entradas de in(v), podando con out(hub) + in(v); hacia atras es simetrico. 'own' son las etiquetas del
+    // hub del mismo lado que la poda ('out' hacia adelante) y 'other' las que se llenan.
+    //*
+    static void pruned_search(const Adjacency &adjacency, std::uint32_t r, std::uint32_t root,
+                              const std::vector<std::vector<Entry>> &own,
+                              const std::vector<std::vector<Entry>> &other,
+                              Scratch &scratch, std::vector<std::pair<std::uint32_t, Entry>> &found) {
+        for (const Entry &entry: own[root]) scratch.hub_dist[entry.hub] = entry.dist;
+
+        typedef std::pair<double, std::uint32_t> QueueEntry;
+        std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> pq;
+        scratch.dist[root] = 0.0;
+        scratch.touched.push_back(root);
+        pq.push({0.0, root});
+
+        while (!pq.empty()) {
+            auto [d, u] = pq.top();
+            pq.pop();
+            if (d > scratch.dist[u]) continue;
+
+            // poda: las etiquetas ya dan una distancia igual o menor
+            bool covered = false;
+            for (const Entry &entry: other[u]) {
+                if (scratch.hub_dist[entry.hub] + entry.dist <= d) {
+                    covered = true;
+                    break;
+                }
+            }
+            if (covered) continue;
+
+            found.push_back({u, {r, static_cast<float>(d), scratch.parent[u]}});
+
+            for (const Arc *arc = adjacency.begin(u); arc != adjacency.end(u); ++arc) {
+                double candidate = d + arc->length;
+                if (candidate < scratch.dist[arc->to]) {
+                    if (scratch.dist[arc->to] == infinity) scratch.touched.push_back(arc->to);
+                    scratch.dist[arc->to] = candidate;
+                    scratch.parent[arc->to] = arc->edge;
+                    pq.push({candidate, arc->to});
+                }
+            }
+        }
+
+        for (std::uint32_t u: scratch.touched) {
+            scratch.dist[u] = infinity;
+            scratch.parent[u] = no_edge;
+        }
+        scratch.touched.clear();
+        for (const Entry &entry: own[root]) scratch.hub_dist[entry.hub] = infinity;
+    }
+
+    //* --- importance_order ---
+    // Corre Dijkstra desde hasta 256 nodos al azar (semilla fija, el orden es reproducible) y suma para cada nodo
+    // el tamaño de su subarbol: cuantos de los caminos minimos muestreados pasan por el. Empates por grado.
+    //*
+    static std::vector<std::uint32_t> importance_order(const Adjacency &forward, unsigned threads) {
+        std::size_t n = forward.node_count();
+        std::size_t samples = std::min<std::size_t>(n, 256);
+        std::vector<std::uint32_t> roots(n);
+        std::iota(roots.begin(), roots.end(), 0);
+        std::shuffle(roots.begin(), roots.end(), std::mt19937(42));
+        roots.resize(samples);
+
+        std::vector<std::vector<double>> partial(threads, std::vector<double>(n, 0.0));
+        std::atomic<std::size_t> cursor {0};
+        auto work = [&](unsigned t) {
+            std::vector<double> dist(n);
+            std::vector<std::uint32_t> parent(n), subtree(n), settled;
+            for (std::size_t i; (i = cursor++) < samples;) {
+                std::fill(dist.begin(), dist.end(), infinity);
+                std::fill(subtree.begin(), subtree.end(), 1);
+                settled.clear();
+
+                typedef std::pair<double, std::uint32_t> QueueEntry;
+                std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> pq;
+                dist[roots[i]] = 0.0;
+                parent[roots[i]] = roots[i];
+                pq.push({0.0, roots[i]});
+                while (!pq.empty()) {
+                    auto [d, u] = pq.top();
+                    pq.pop();
+                    if (d > dist[u]) continue;
+                    settled.push_back(u);
+                    for (const Arc *arc = forward.begin(u); arc != forward.end(u); ++arc) {
+                        if (d + arc->length < dist[arc->to]) {
+                            dist[arc->to] = d + arc->length;
+                            parent[arc->to] = u;
+                            pq.push({dist[arc->to], arc->to});
+                        }
+                    }
+                }
+                for (std::size_t k = settled.size(); k-- > 1;) {
+                    std::uint32_t u = settled[k];
+                    subtree[parent[u]] += subtree[u];
+                }
+                for (std::uint32_t u: settled) partial[t][u] += subtree[u];
+            }
+        };
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < threads; ++t) workers.emplace_back(work, t);
+        for (std::thread &worker: workers) worker.join();
+
+        std::vector<double> score(n, 0.0);
+        for (const std::vector<double> &p: partial) {
+            for (std::size_t u = 0; u < n; ++u) score[u] += p[u];
+        }
+
+        std::vector<std::uint32_t> order(n);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b) {
+            if (score[a] != score[b]) return score[a] > score[b];
+            return forward.end(a) - forward.begin(a) > forward.end(b) - forward.begin(b);
+        });
+        return order;
+    }
+
+    static void flatten(std::vector<std::vector<Entry>> &building, Labels &labels) {
+        std::size_t n = building.size();
+        labels = Labels();
+        labels.offsets.assign(n + 1, 0);
+        for (std::size_t v = 0; v < n; ++v) {
+            labels.offsets[v + 1] = labels.offsets[v] + static_cast<std::uint32_t>(building[v].size());
+        }
+        labels.hubs.reserve(labels.offsets[n]);
+        labels.dists.reserve(labels.offsets[n]);
+        labels.parents.reserve(labels.offsets[n]);
+        for (std::vector<Entry> &entries: building) {
+            for (const Entry &entry: entries) {
+                labels.hubs.push_back(entry.hub);
+                labels.dists.push_back(entry.dist);
+                labels.parents.push_back(entry.parent);
+            }
+            std::vector<Entry>().swap(entries);
+        }
+    }
+
+    // (rango del mejor hub, distancia) mezclando out(u) e in(v)
+    std::pair<std::uint32_t, double> best_hub(std::uint32_t u, std::uint32_t v) const {
+        std::uint32_t i = out.offsets[u], i_end = out.offsets[u + 1];
+        std::uint32_t j = in.offsets[v], j_end = in.offsets[v + 1];
+        std::pair<std::uint32_t, double> best {0, infinity};
+        while (i < i_end && j < j_end) {
+            if (out.hubs[i] < in.hubs[j]) {
+                i++;
+            } else if (out.hubs[i] > in.hubs[j]) {
+                j++;
+            } else {
+                double d = static_cast<double>(out.dists[i]) + in.dists[j];
+                if (d < best.second) best = {out.hubs[i], d};
+                i++;
+                j++;
+            }
+        }
+        return best;
+    }
+
+    static std::uint32_t parent_of(const Labels &labels, std::uint32_t v, std::uint32_t hub) {
+        auto begin = labels.hubs.begin() + labels.offsets[v], end = labels.hubs.begin() + labels.offsets[v + 1];
+        auto it = std::lower_bound(begin, end, hub);
+        return labels.parents[it - labels.hubs.begin()];
+    }
+
+    template<typename EdgePointer>
+    static std::uint32_t other_end(const EdgePointer &edge, std::uint32_t current) {
+        return static_cast<std::uint32_t>(edge->src->index == current ? edge->dest->index : edge->src->index);
+    }
+
+    // offsets[0] == 0 y no decrecientes
+    static bool valid_offsets(const std::vector<std::uint32_t> &offsets) {
+        if (offsets.empty() || offsets.front() != 0) return false;
+        return std::is_sorted(offsets.begin(), offsets.end());
+    }
+
+    // 'order' es una permutacion de los nodos, los hubs son rangos, los padres aristas (o 'no_edge') y las
+    // distancias no negativas
+    bool valid() const {
+        std::size_t n = order.size();
+        std::vector<char> seen(n, false);
+        for (std::uint32_t v: order) {
+            if (v >= n || seen[v]) return false;
+            seen[v] = true;
+        }
+        for (const Labels *labels: {&out, &in}) {
+            for (std::size_t i = 0; i < labels->hubs.size(); ++i) {
+                std::uint32_t parent = labels->parents[i];
+                if (labels->hubs[i] >= n || (parent != no_edge && parent >= edge_count) ||
+                    !(labels->dists[i] >= 0.0f)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    template<typename T>
+    static void write(std::ofstream &file, const T &value) {
+        file.write(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    template<typename T>
+    static void read(std::ifstream &file, T &value) {
+        file.read(reinterpret_cast<char *>(&value), sizeof(T));
+    }
+
+    template<typename T>
+    static void write_vector(std::ofstream &file, const std::vector<T> &values) {
+        file.write(reinterpret_cast<const char *>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(T)));
+    }
+
+    template<typename T>
+    static bool read_vector(std::ifstream &file, std::vector<T> &values, std::size_t count) {
+        std::streampos start = file.tellg();
+        file.seekg(0, std::ios::end);
+        std::streamoff remaining = file.tellg() - start;
+        file.seekg(start);
+        if (!file || remaining < 0 || count > static_cast<std::uint64_t>(remaining) / sizeof(T)) {
+            return false;
+        }
+        values.resize(count);
+        file.read(reinterpret_cast<char *>(values.data()), static_cast<std::streamsize>(count * sizeof(T)));
+        return static_cast<bool>(file);
+    }
+};
+
+
+#endif //HOMEWORK_GRAPH_HUB_LABELS_H
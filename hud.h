@@ -0,0 +1,265 @@
+//
+// Created by juan-diego on 3/29/24.
+//
+
+#ifndef HOMEWORK_GRAPH_HUD_H
+#define HOMEWORK_GRAPH_HUD_H
+
+#include "window_manager.h"
+#include "search_budget.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+// Etapas de un frame de 'GUI::main_loop', en el orden en que ocurren
+enum FramePhase {
+    EventsPhase,    // Atender eventos (incluye las busquedas lanzadas con una tecla)
+    GraphPhase,     // Graph::draw
+    PathPhase,      // PathFindingManager::draw
+    HudPhase,       // Hud::draw
+    DisplayPhase,   // WindowManager::display (incluye la espera del limite de fps)
+    PhaseCount
+};
+
+inline const char *to_string(FramePhase phase) {
+    switch (phase) {
+        case EventsPhase: return "eventos";
+        case GraphPhase: return "grafo";
+        case PathPhase: return "camino";
+        case HudPhase: return "hud";
+        case DisplayPhase: return "display";
+        default: return "?";
+    }
+}
+
+
+// Tiempos y costo de dibujo de un frame
+struct FrameSample {
+    float phase_ms[PhaseCount] {};
+    float total_ms = 0.0f;
+    RenderCounters counters;
+};
+
+
+// *
+// ---- FrameProfiler ----
+// Mide cuanto dura cada etapa de los ultimos 'capacity' frames (buffer circular, sin reservar memoria despues
+// de llenarse). 'end_phase' asigna a la etapa el tiempo transcurrido desde la marca anterior.
+//
+// Funciones miembro
+//     - begin_frame   : Marca el inicio de un frame
+//     - end_phase     : Cierra una etapa del frame en curso
+//     - end_frame     : Cierra el frame y guarda sus contadores de dibujo
+//     - percentile    : Percentil p (0..1) de la duracion total de los frames guardados
+//     - average       : Promedio de una etapa
+//     - dump          : Escribe todos los frames guardados (del mas antiguo al mas nuevo) en un csv
+// *
+class FrameProfiler {
+    typedef std::chrono::steady_clock Clock;
+
+    std::vector<FrameSample> samples;
+    std::size_t capacity;
+    std::size_t next = 0;
+    std::uint64_t frames = 0;
+    FrameSample current;
+    Clock::time_point frame_start;
+    Clock::time_point mark;
+
+public:
+    explicit FrameProfiler(std::size_t capacity = 1024) : capacity(capacity) {
+        samples.reserve(capacity);
+    }
+
+    void begin_frame() {
+        current = FrameSample();
+        frame_start = mark = Clock::now();
+    }
+
+    void end_phase(FramePhase phase) {
+        Clock::time_point now = Clock::now();
+        current.phase_ms[phase] += std::chrono::duration<float, std::milli>(now - mark).count();
+        mark = now;
+    }
+
+    void end_frame(const RenderCounters &counters) {
+        current.total_ms = std::chrono::duration<float, std::milli>(Clock::now() - frame_start).count();
+        current.counters = counters;
+        if (samples.size() < capacity) {
+            samples.push_back(current);
+        } else {
+            samples[next] = current;
+        }
+        next = (next + 1) % capacity;
+        frames++;
+    }
+
+    bool empty() const {
+        return samples.empty();
+    }
+
+    const FrameSample &last() const {
+        return samples[(next + capacity - 1) % capacity];
+    }
+
+    float percentile(double p) const {
+        if (samples.empty()) return 0.0f;
+        std::vector<float> totals;
+        totals.reserve(samples.size());
+        for (const FrameSample &sample: samples) totals.push_back(sample.total_ms);
+        auto k = std::min(totals.size() - 1, static_cast<std::size_t>(p * totals.size()));
+        std::nth_element(totals.begin(), totals.begin() + static_cast<std::ptrdiff_t>(k), totals.end());
+        return totals[k];
+    }
+
+    float average(FramePhase phase) const {
+        if (samples.empty()) return 0.0f;
+        float sum = 0.0f;
+        for (const FrameSample &sample: samples) sum += sample.phase_ms[phase];
+        return sum / static_cast<float>(samples.size());
+    }
+
+    bool dump(const std::string &path) const {
+        std::ofstream file(path);
+        if (!file) return false;
+
+        file << "frame";
+        for (int phase = 0; phase < PhaseCount; ++phase) file << "," << to_string(FramePhase(phase)) << "_ms";
+        file << ",total_ms,draw_calls,vertices\n";
+
+        // el mas antiguo esta en 'next' una vez que el buffer se lleno
+        std::size_t start = samples.size() < capacity ? 0 : next;
+        std::uint64_t first = frames - samples.size();
+        for (std::size_t i = 0; i < samples.size(); ++i) {
+            const FrameSample &sample = samples[(start + i) % samples.size()];
+            file << first + i;
+            for (float ms: sample.phase_ms) file << "," << ms;
+            file << "," << sample.total_ms << "," << sample.counters.draw_calls << "," << sample.counters.vertices
+                 << "\n";
+        }
+        return static_cast<bool>(file);
+    }
+};
+
+
+// *
+// ---- Hud ----
+// Panel superpuesto a la ventana con los percentiles del tiempo por frame, el promedio de cada etapa, las
+// llamadas a draw y vertices del ultimo frame, el limite de fps y las estadisticas de la ultima busqueda.
+// Se dibuja con la vista por defecto, asi no se mueve con la camara. Si no encuentra ninguna fuente en
+// 'font_paths' escribe el mismo texto en consola una vez por segundo mientras este visible.
+//
+// Variables miembro
+//     - profiler      : Tiempos de los ultimos frames
+//     - visible       : Si el panel se muestra
+//     - frame_rate_limit: Limite de fps de la ventana (0 = sin limite), solo para mostrarlo
+//
+// Funciones miembro
+//     - toggle        : Muestra u oculta el panel
+//     - draw          : Dibuja el panel (o lo escribe en consola) si esta visible
+//     - dump          : Guarda la traza de frames en un csv
+// *
+class Hud {
+    sf::Font font;
+    bool font_loaded = false;
+    std::chrono::steady_clock::time_point last_console;
+
+public:
+    FrameProfiler profiler;
+    bool visible = false;
+    unsigned frame_rate_limit = 0;
+
+    Hud() {
+        static const char *font_paths[] = {
+                "font.ttf",
+                "/usr/share/fonts/truetype/dejavu/DejaVuSansMono.ttf",
+                "/usr/share/fonts/TTF/DejaVuSansMono.ttf",
+                "/usr/share/fonts/dejavu/DejaVuSansMono.ttf",
+                "/usr/share/fonts/truetype/liberation/LiberationMono-Regular.ttf",
+                "/System/Library/Fonts/Menlo.ttc",
+                "/Library/Fonts/Arial.ttf",
+                "C:/Windows/Fonts/consola.ttf",
+        };
+        for (const char *path: font_paths) {
+            if (font.loadFromFile(path)) {
+                font_loaded = true;
+                break;
+            }
+        }
+    }
+
+    void toggle() {
+        visible = !visible;
+        if (visible && !font_loaded) {
+            std::cout << "HUD: no se encontro una fuente, las estadisticas se muestran en consola" << std::endl;
+        }
+    }
+
+    void draw(WindowManager &window_manager, const SearchStats &stats) {
+        if (!visible || profiler.empty()) return;
+        std::string text = report(stats);
+
+        if (!font_loaded) {
+            auto now = std::chrono::steady_clock::now();
+            if (now - last_console >= std::chrono::seconds(1)) {
+                std::cout << text << std::endl;
+                last_console = now;
+            }
+            return;
+        }
+
+        sf::RenderWindow &window = window_manager.get_window();
+        sf::View view = window.getView();
+        window.setView(window.getDefaultView());
+
+        sf::Text label(text, font, 12);
+        label.setFillColor(sf::Color::White);
+        label.setPosition(8.0f, 6.0f);
+
+        sf::RectangleShape background(sf::Vector2f(330.0f, 84.0f));
+        background.setFillColor(sf::Color(0, 0, 0, 170));
+        background.setPosition(4.0f, 4.0f);
+
+        window.draw(background);
+        window.draw(label);
+        window.setView(view);
+
+        // rectangulo: 4 vertices; texto: 4 por caracter
+        window_manager.record_draw(2, 4 + 4 * text.size());
+    }
+
+    bool dump(const std::string &path) const {
+        return profiler.dump(path);
+    }
+
+private:
+    std::string report(const SearchStats &stats) const {
+        const FrameSample &last = profiler.last();
+        float p50 = profiler.percentile(0.50);
+
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(2)
+            << "frame p50 " << p50 << " ms  p95 " << profiler.percentile(0.95)
+            << "  p99 " << profiler.percentile(0.99) << "  (" << std::setprecision(0)
+            << (p50 > 0.0f ? 1000.0f / p50 : 0.0f) << " fps, limite "
+            << (frame_rate_limit ? std::to_string(frame_rate_limit) : "no") << ")\n"
+            << std::setprecision(2);
+        for (int phase = 0; phase < PhaseCount; ++phase) {
+            out << to_string(FramePhase(phase)) << " " << profiler.average(FramePhase(phase))
+                << (phase + 1 < PhaseCount ? "  " : " ms\n");
+        }
+        out << "draw calls " << last.counters.draw_calls << "  vertices " << last.counters.vertices << "\n"
+            << "busqueda: " << to_string(stats.status) << "  nodos " << stats.settled
+            << "  costo " << stats.cost << "  " << stats.elapsed_ms << " ms";
+        return out.str();
+    }
+};
+
+
+#endif //HOMEWORK_GRAPH_HUD_H
@@ -1,7 +1,111 @@
 #include "gui.h"
+#include "routing_server.h"
+#include "tiled_viewer.h"
+#include "compact_graph.h"
 
-int main() {
-    GUI gui("nodes.csv", "edges.csv");
+#include <cstring>
+#include <string>
+
+// Uso:
+//     homework_graph [--fps N] [--facilities <csv>]            -> GUI (N = 0: sin limite de fps)
+//     homework_graph --server <socket> [--workers N] [--arc-flags] [--hub-labels <archivo>]
+//                    [--facilities <csv>]                      -> servidor local (ver 'routing_server.h')
+//     homework_graph --build-tiles <archivo> [--grid N]         -> escribe el grafo por teselas y termina
+//     homework_graph --tiles <archivo> [--tile-cache N] [--fps N] -> GUI sobre el archivo de teselas
+//     homework_graph --compact <id origen> <id destino>        -> ruta con solo la adyacencia comprimida
+//
+// '--facilities' es el csv de objetivos de la consulta al mas cercano (ver 'facility_set.h').
+// '--grid' es la cantidad de teselas por lado (16 por defecto) y '--tile-cache' cuantas se mantienen en memoria
+// (64 por defecto), ver 'tiled_graph.h'. '--compact' carga el grafo sin 'Node' ni 'Edge' (ver 'compact_graph.h').
+int main(int argc, char **argv) {
+    bool server = false;
+    unsigned frame_rate_limit = 200;
+    RoutingServerOptions options;
+    std::string build_tiles, tiles;
+    unsigned grid = 16;
+    std::size_t tile_cache = 64;
+    bool compact = false;
+    std::uint64_t compact_src = 0, compact_dest = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--server") == 0 && i + 1 < argc) {
+            server = true;
+            options.socket_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            options.workers = static_cast<unsigned>(std::max(1, std::atoi(argv[++i])));
+        } else if (std::strcmp(argv[i], "--arc-flags") == 0) {
+            options.arc_flags = true;
+        } else if (std::strcmp(argv[i], "--hub-labels") == 0 && i + 1 < argc) {
+            options.hub_labels = argv[++i];
+        } else if (std::strcmp(argv[i], "--facilities") == 0 && i + 1 < argc) {
+            options.facilities = argv[++i];
+        } else if (std::strcmp(argv[i], "--build-tiles") == 0 && i + 1 < argc) {
+            build_tiles = argv[++i];
+        } else if (std::strcmp(argv[i], "--grid") == 0 && i + 1 < argc) {
+            grid = static_cast<unsigned>(std::max(1, std::atoi(argv[++i])));
+        } else if (std::strcmp(argv[i], "--tiles") == 0 && i + 1 < argc) {
+            tiles = argv[++i];
+        } else if (std::strcmp(argv[i], "--tile-cache") == 0 && i + 1 < argc) {
+            tile_cache = static_cast<std::size_t>(std::max(2, std::atoi(argv[++i])));
+        } else if (std::strcmp(argv[i], "--compact") == 0 && i + 2 < argc) {
+            compact = true;
+            compact_src = std::strtoull(argv[++i], nullptr, 10);
+            compact_dest = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+            frame_rate_limit = static_cast<unsigned>(std::max(0, std::atoi(argv[++i])));
+        } else {
+            std::cerr << "Argumento desconocido: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    if (server) {
+#ifdef HOMEWORK_GRAPH_ROUTING_SERVER
+        Graph graph(nullptr);
+        graph.parse_csv("nodes.csv", "edges.csv");
+        RoutingServer routing_server(graph, options);
+        return routing_server.run();
+#else
+        std::cerr << "El modo servidor necesita sockets Unix" << std::endl;
+        return 1;
+#endif
+    }
+
+    if (!build_tiles.empty()) {
+        Graph graph(nullptr);
+        graph.parse_csv("nodes.csv", "edges.csv");
+        bool built = TiledGraph::build(graph, build_tiles, grid);
+        std::cout << (built ? "Teselas guardadas en " : "No se pudo escribir ") << build_tiles << std::endl;
+        return built ? 0 : 1;
+    }
+
+    if (compact) {
+        CompactGraph graph;
+        if (!graph.load("nodes.csv", "edges.csv")) {
+            std::cerr << "No se pudo leer nodes.csv o edges.csv" << std::endl;
+            return 1;
+        }
+        std::cout << "Grafo compacto: " << graph.size() << " nodos, " << graph.memory_bytes() / 1024 << " KiB"
+                  << std::endl;
+
+        std::uint32_t src, dest;
+        if (!graph.find(compact_src, src) || !graph.find(compact_dest, dest)) {
+            std::cerr << "Id de OSM desconocido" << std::endl;
+            return 1;
+        }
+        CompactRoute route = CompactSearch::run(graph, src, dest);
+        std::cout << to_string(route.status) << ": costo " << route.cost << ", " << route.path.size()
+                  << " nodos en el camino, " << route.settled << " nodos procesados, "
+                  << route.memory_bytes / 1024 << " KiB de busqueda" << std::endl;
+        return route.status == Found ? 0 : 1;
+    }
+
+    if (!tiles.empty()) {
+        TiledViewer viewer(tiles, tile_cache, frame_rate_limit);
+        viewer.main_loop();
+        return 0;
+    }
+
+    GUI gui("nodes.csv", "edges.csv", frame_rate_limit, options.facilities);
     gui.main_loop();
     return 0;
 }
@@ -0,0 +1,167 @@
+//
+// Created by juan-diego on 3/29/24.
+//
+
+#ifndef HOMEWORK_GRAPH_MULTI_SOURCE_DIJKSTRA_H
+#define HOMEWORK_GRAPH_MULTI_SOURCE_DIJKSTRA_H
+
+#include "graph.h"
+#include "simd_kernels.h"
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <queue>
+#include <vector>
+
+
+// *
+// ---- MultiSourceDijkstra ----
+// Calcula a la vez los arboles de caminos minimos de hasta 'lanes' origenes (8 o 16) sobre 'Graph::forward'.
+// Cada nodo guarda un vector con una distancia por origen (carril) y cada arco se relaja para todos los
+// carriles con una sola llamada a 'SimdKernels::relax_lanes' (suma y minimo vectoriales), asi que la
+// adyacencia se lee una vez por lote en lugar de una vez por origen.
+//
+// Es una busqueda de correccion de etiquetas con un solo orden de recorrido para todos los carriles: la cola
+// se ordena por la menor distancia que mejoro en el nodo desde la ultima vez que se proceso. Un nodo vuelve a
+// procesarse cada vez que otro origen lo alcanza despues, pero si los origenes estan cerca entre si sus
+// frentes de onda llegan casi juntos y cada proceso avanza varios carriles a la vez. Con origenes dispersos
+// cada nodo se procesa una vez por carril y el lote cuesta mas que las busquedas por separado, por eso
+// 'RoutingServer' solo agrupa origenes cercanos (ver 'RoutingServerOptions::batch_radius').
+//
+// Con 'targets' se detiene antes: una vez que la cola supera la mayor distancia hacia los objetivos, ninguna
+// de esas distancias puede mejorar. Los arreglos se reutilizan entre corridas (solo se limpian los nodos
+// tocados), asi que conviene una instancia por hilo.
+//
+// Funciones miembro
+//     - run           : Arboles de los 'sources' (a lo mas 'lanes'); el carril i es el de sources[i]
+//     - distance      : Distancia del origen del carril 'lane' al nodo
+//     - distances     : Arreglo de distancias del carril 'lane', indexado por 'Node::index'
+//     - scanned_count : Veces que se proceso un nodo en la ultima corrida
+// *
+class MultiSourceDijkstra {
+    const Graph &graph;
+    std::size_t width;
+    std::vector<double> dist;     // dist[v * width + lane]
+    std::vector<double> pending;  // menor distancia que mejoro en v desde que se proceso (infinito = al dia)
+    std::vector<char> seen;
+    std::vector<std::uint32_t> touched;
+    std::size_t scanned = 0;
+
+    typedef std::pair<double, std::uint32_t> QueueEntry;
+    typedef std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> Queue;
+
+    static constexpr double infinity = std::numeric_limits<double>::infinity();
+
+public:
+    explicit MultiSourceDijkstra(const Graph &graph, std::size_t lanes = 8)
+            : graph(graph),
+              width(lanes > 8 ? 16 : 8),
+              dist(graph.node_storage.size() * width, infinity),
+              pending(graph.node_storage.size(), infinity),
+              seen(graph.node_storage.size(), false) {}
+
+    std::size_t lanes() const {
+        return width;
+    }
+
+    void run(const std::vector<std::uint32_t> &sources, const std::vector<std::uint32_t> &targets = {}) {
+        for (std::uint32_t u: touched) {
+            std::fill_n(dist.begin() + u * width, width, infinity);
+            pending[u] = infinity;
+            seen[u] = false;
+        }
+        touched.clear();
+        scanned = 0;
+
+        std::size_t count = std::min(sources.size(), width);
+        if (count == 0) return;
+        Queue pq;
+        for (std::size_t lane = 0; lane < count; ++lane) {
+            std::uint32_t s = sources[lane];
+            touch(s);
+            row(s)[lane] = 0.0;
+            if (pending[s] != 0.0) {
+                pending[s] = 0.0;
+                pq.push({0.0, s});
+            }
+        }
+
+        // objetivos que cada carril puede alcanzar (ver 'Components::may_reach'); los demas no frenan la parada
+        std::vector<std::pair<std::uint32_t, std::size_t>> watched;
+        for (std::uint32_t target: targets) {
+            for (std::size_t lane = 0; lane < count; ++lane) {
+                if (graph.components.may_reach(sources[lane], target)) watched.push_back({target, lane});
+            }
+        }
+        double limit = infinity;
+
+        while (!pq.empty()) {
+            auto [key, u] = pq.top();
+            pq.pop();
+            if (key != pending[u]) continue;  // entrada vieja: el nodo ya se proceso con este valor o uno menor
+
+            if (!targets.empty() && (scanned % 256 == 0 || key >= limit)) {
+                limit = watched_limit(watched);
+                if (key >= limit) break;
+            }
+
+            pending[u] = infinity;
+            scan(u, pq);
+        }
+    }
+
+    // como en 'ShortestPathTree', std::numeric_limits<double>::max() si no se alcanzo
+    double distance(std::size_t lane, std::uint32_t v) const {
+        double d = dist[v * width + lane];
+        return d == infinity ? std::numeric_limits<double>::max() : d;
+    }
+
+    std::vector<double> distances(std::size_t lane) const {
+        std::vector<double> out(graph.node_storage.size());
+        for (std::uint32_t v = 0; v < out.size(); ++v) out[v] = distance(lane, v);
+        return out;
+    }
+
+    std::size_t scanned_count() const {
+        return scanned;
+    }
+
+private:
+    double *row(std::uint32_t v) {
+        return dist.data() + v * width;
+    }
+
+    void touch(std::uint32_t v) {
+        if (!seen[v]) {
+            seen[v] = true;
+            touched.push_back(v);
+        }
+    }
+
+    // Relaja los arcos de 'u' en todos los carriles y encola los vecinos que mejoraron
+    void scan(std::uint32_t u, Queue &pq) {
+        scanned++;
+        const double *from = row(u);
+        for (const Arc *arc = graph.forward.begin(u); arc != graph.forward.end(u); ++arc) {
+            double improved = SimdKernels::relax_lanes(from, arc->length, row(arc->to), width);
+            if (improved == infinity) continue;
+            touch(arc->to);
+            if (improved < pending[arc->to]) {
+                pending[arc->to] = improved;
+                pq.push({improved, arc->to});
+            }
+        }
+    }
+
+    // mayor distancia actual hacia los objetivos vigilados (infinito si alguno no se alcanzo todavia)
+    double watched_limit(const std::vector<std::pair<std::uint32_t, std::size_t>> &watched) const {
+        double limit = 0.0;
+        for (auto [target, lane]: watched) {
+            limit = std::max(limit, dist[target * width + lane]);
+        }
+        return limit;
+    }
+};
+
+
+#endif //HOMEWORK_GRAPH_MULTI_SOURCE_DIJKSTRA_H
@@ -24,6 +24,8 @@ struct Edge;
 //
 // Variables miembro
 //     - id            : Identificador de un vertice, debe ser irrepetible entre vertices
+//     - index         : Posicion densa del vertice dentro del grafo (0 .. n-1). Lo asigna 'Graph' al cargar y
+//                       sirve para indexar los arreglos de las busquedas en lugar de usar tablas hash
 //     - coord         : La coordenada donde se encuentra el vertice (usado por SFML)
 //     - edges         : El conjunto de aristas asociadas al vertice
 //     - color         : Color del vertice (usado por SFML)
@@ -36,6 +38,7 @@ struct Edge;
 // *
 struct Node {
     std::size_t id;
+    std::size_t index = 0;
     sf::Vector2f coord;
     std::vector<Edge *> edges {};
 
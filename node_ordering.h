@@ -0,0 +1,166 @@
+//
+// Created by juan-diego on 3/11/24.
+//
+
+#ifndef HOMEWORK_GRAPH_NODE_ORDERING_H
+#define HOMEWORK_GRAPH_NODE_ORDERING_H
+
+#include "node.h"
+#include "edge.h"
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <queue>
+#include <vector>
+
+
+// Este enum sirve para elegir en que orden se guardan los vertices en memoria al cargar el grafo
+enum NodeOrder {
+    OriginalOrder,  // Orden de los ids de OSM (orden del std::map)
+    HilbertOrder,   // Orden a lo largo de una curva de Hilbert sobre 'coord'
+    BFSOrder        // Orden de Cuthill-McKee (BFS visitando primero a los vecinos de menor grado)
+};
+
+
+// *
+// ---- NodeReordering ----
+// Calcula una permutacion de los vertices tal que vertices cercanos en el mapa queden cercanos en memoria.
+// Los ids de OSM no tienen relacion con la geometria, asi que dos vertices vecinos pueden terminar muy lejos
+// uno del otro; las busquedas recorren vecinos todo el tiempo, por lo que esto se traduce en fallos de cache.
+//
+// Funciones miembro
+//     - compute       : Devuelve los vertices en el orden pedido
+//     - hilbert       : Ordena por la posicion de 'coord' sobre una curva de Hilbert de 2^16 x 2^16 celdas
+//     - cuthill_mckee : Ordena por BFS (Cuthill-McKee) sobre el grafo no dirigido subyacente
+// *
+struct NodeReordering {
+    static std::vector<Node *> compute(const std::map<std::size_t, Node *> &nodes, NodeOrder order) {
+        switch (order) {
+            case HilbertOrder:
+                return hilbert(nodes);
+            case BFSOrder:
+                return cuthill_mckee(nodes);
+            default: {
+                std::vector<Node *> sequence;
+                sequence.reserve(nodes.size());
+                for (auto &[_, node]: nodes) {
+                    sequence.push_back(node);
+                }
+                return sequence;
+            }
+        }
+    }
+
+    // Distancia de (x, y) a lo largo de una curva de Hilbert de lado 'side' (potencia de dos)
+    static std::uint64_t hilbert_index(std::uint32_t x, std::uint32_t y, std::uint32_t side = 1u << 16) {
+        std::uint64_t d = 0;
+        for (std::uint32_t s = side / 2; s > 0; s /= 2) {
+            std::uint32_t rx = (x & s) > 0;
+            std::uint32_t ry = (y & s) > 0;
+            d += static_cast<std::uint64_t>(s) * s * ((3 * rx) ^ ry);
+
+            // rotar el cuadrante para que la curva sea continua
+            if (ry == 0) {
+                if (rx == 1) {
+                    x = side - 1 - x;
+                    y = side - 1 - y;
+                }
+                std::swap(x, y);
+            }
+        }
+        return d;
+    }
+
+    static std::vector<Node *> hilbert(const std::map<std::size_t, Node *> &nodes) {
+        float min_x = std::numeric_limits<float>::max(), min_y = std::numeric_limits<float>::max();
+        float max_x = std::numeric_limits<float>::lowest(), max_y = std::numeric_limits<float>::lowest();
+        for (auto &[_, node]: nodes) {
+            min_x = std::min(min_x, node->coord.x);
+            min_y = std::min(min_y, node->coord.y);
+            max_x = std::max(max_x, node->coord.x);
+            max_y = std::max(max_y, node->coord.y);
+        }
+
+        // escalar las coordenadas a la grilla de la curva
+        const double cells = (1u << 16) - 1;
+        double scale_x = max_x > min_x ? cells / (max_x - min_x) : 0.0;
+        double scale_y = max_y > min_y ? cells / (max_y - min_y) : 0.0;
+
+        std::vector<std::pair<std::uint64_t, Node *>> keyed;
+        keyed.reserve(nodes.size());
+        for (auto &[_, node]: nodes) {
+            auto x = static_cast<std::uint32_t>((node->coord.x - min_x) * scale_x);
+            auto y = static_cast<std::uint32_t>((node->coord.y - min_y) * scale_y);
+            keyed.emplace_back(hilbert_index(x, y), node);
+        }
+
+        // stable_sort para que los empates conserven el orden por id
+        std::stable_sort(keyed.begin(), keyed.end(), [](const auto &a, const auto &b) {
+            return a.first < b.first;
+        });
+
+        std::vector<Node *> sequence;
+        sequence.reserve(keyed.size());
+        for (auto &[_, node]: keyed) {
+            sequence.push_back(node);
+        }
+        return sequence;
+    }
+
+    // Requiere que 'Node::edges' y 'Node::index' ya esten asignados
+    static std::vector<Node *> cuthill_mckee(const std::map<std::size_t, Node *> &nodes) {
+        // vecino al otro lado de la arista, ignorando la direccion
+        auto other = [](Edge *edge, Node *node) -> Node * {
+            return edge->src == node ? edge->dest : edge->src;
+        };
+
+        // los vertices de menor grado inician cada componente
+        std::vector<Node *> by_degree;
+        by_degree.reserve(nodes.size());
+        for (auto &[_, node]: nodes) {
+            by_degree.push_back(node);
+        }
+        std::stable_sort(by_degree.begin(), by_degree.end(), [](Node *a, Node *b) {
+            return a->edges.size() < b->edges.size();
+        });
+
+        std::vector<Node *> sequence;
+        sequence.reserve(nodes.size());
+        std::vector<char> visited(nodes.size(), false);
+        std::vector<Node *> neighbors;
+
+        for (Node *start: by_degree) {
+            if (visited[start->index]) continue;
+
+            std::queue<Node *> queue;
+            queue.push(start);
+            visited[start->index] = true;
+
+            while (!queue.empty()) {
+                Node *current = queue.front();
+                queue.pop();
+                sequence.push_back(current);
+
+                neighbors.clear();
+                for (Edge *edge: current->edges) {
+                    Node *neighbor = other(edge, current);
+                    if (neighbor != nullptr && !visited[neighbor->index]) {
+                        visited[neighbor->index] = true;
+                        neighbors.push_back(neighbor);
+                    }
+                }
+                std::stable_sort(neighbors.begin(), neighbors.end(), [](Node *a, Node *b) {
+                    return a->edges.size() < b->edges.size();
+                });
+                for (Node *neighbor: neighbors) {
+                    queue.push(neighbor);
+                }
+            }
+        }
+        return sequence;
+    }
+};
+
+
+#endif //HOMEWORK_GRAPH_NODE_ORDERING_H
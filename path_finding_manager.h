@@ -8,6 +8,9 @@
 
 #include "window_manager.h"
 #include "graph.h"
+#include "search_budget.h"
+#include "alternative_routes.h"
+#include "exploration_trace.h"
 #include <unordered_map>
 #include <unordered_set>
 #include <set>
@@ -19,7 +22,12 @@ enum Algorithm {
     None,
     Dijkstra,
     AStar,
-    BestFirstSearch
+    BestFirstSearch,
+    WeightedAStar,   // A* con heuristica inflada por (1 + epsilon): costo <= (1 + epsilon) * optimo
+    AnytimeAStar,    // ARA*: entrega un camino rapido y lo mejora hasta llegar al optimo o agotar el presupuesto
+    ArcFlagsDijkstra,// Dijkstra que ignora los arcos sin la bandera de la region de 'dest' (ver 'arc_flags.h')
+    CompressedDijkstra,// Dijkstra sobre la adyacencia comprimida, con pesos enteros en decimetros
+    HubLabelQuery    // Distancia por hub labels (ver 'hub_labels.h') y camino desempaquetado de las etiquetas
 };
 
 
@@ -29,19 +37,48 @@ enum Algorithm {
 //
 // Variables miembro
 //     - path           : Contiene el camino resultante del algoritmo que se desea simular
-//     - visited_edges  : Contiene todas las aristas que se visitaron en el algoritmo, notar que 'path'
-//                        es un subconjunto de 'visited_edges'.
+//     - path_ids       : Ids de OSM de los nodos del ultimo camino, de 'src' a 'dest', incluyendo los nodos que
+//                        la simplificacion contrajo dentro de las aristas
+//     - routes         : Rutas de la ultima llamada a 'alternatives' (la primera es la optima) o a 'nearest'
+//                        (del objetivo mas cercano al mas lejano)
+//     - trace          : Aristas que se visitaron en el algoritmo, en orden (8 bytes por evento, ver
+//                        'exploration_trace.h'); notar que 'path' es un subconjunto de la traza
 //     - window_manager : Instancia del manejador de ventana, es utilizado para dibujar cada paso del algoritmo
 //     - src            : Nodo incial del que se parte en el algoritmo seleccionado
 //     - dest           : Nodo al que se quiere llegar desde 'src'
+//     - stats          : Estadisticas y estado final de la ultima busqueda
+//     - guard          : Presupuesto (tiempo, nodos, memoria) y cancelacion de la busqueda en curso
+//     - epsilon        : Suboptimalidad permitida por 'WeightedAStar'
+//     - anytime_epsilon: Suboptimalidad de la primera solucion de 'AnytimeAStar'; se reduce a la mitad en cada
+//                        mejora hasta llegar a 0
+//     - log            : Donde se escriben los mensajes de progreso y las estadisticas (por defecto std::cout)
+//     - tracing        : Si se llena 'trace'; por defecto solo cuando hay 'window_manager'
+//
+// Sin 'window_manager' (modo servidor) no se dibuja nada ni, salvo que se active 'tracing', se guarda la traza.
 //*
 class PathFindingManager {
     WindowManager *window_manager;
     Graph *current_graph = nullptr;
     std::vector<sfLine> path;
-    std::vector<sfLine> visited_edges;
+    ExplorationTrace trace;
+    std::vector<std::size_t> path_ids;
+    std::vector<AlternativeRoute> routes;
     int render_counter = 0;
 
+    SearchStats stats;
+    BudgetGuard guard;
+    CancellationToken *token = nullptr;
+    std::size_t fixed_memory = 0;
+
+    // Buffers de 'collect_neighbors', se reutilizan entre iteraciones para no reservar memoria
+    struct Neighbor {
+        Node *node;
+        Edge *edge;
+    };
+    std::vector<Neighbor> neighbors;
+    std::vector<std::uint32_t> neighbor_indices;
+    std::vector<float> neighbor_heuristics;
+
     struct Entry {
         Node* node;
         double dist;
@@ -58,25 +95,23 @@ class PathFindingManager {
     };
 
     void dijkstra(Graph &graph) {
-        std::unordered_map<Node *, Node *> parent;
+        begin_trace(graph, sf::Color(100, 100, 255, 100), 1.0f);
+
+        std::vector<Node *> parent(graph.nodes.size(), nullptr);
 
-        // mapa de distancias
-        std::unordered_map<Node*, double> dist;
+        // distancias indexadas por 'Node::index', inicializadas como infinito
+        std::vector<double> dist(graph.nodes.size(), std::numeric_limits<double>::max());
 
         // min-heap de nodos a visitar, ordenados por distancia
         std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> pq;
 
-        // set de nodos ya procesados
-        std::unordered_set<Node*> closed_set;
+        // nodos ya procesados
+        std::vector<char> closed_set(graph.nodes.size(), false);
 
-        // distancias como infinito
-        for (auto& [id, node] : graph.nodes) {
-            dist[node] = std::numeric_limits<double>::max();
-        }
+        fixed_memory = graph.nodes.size() * (sizeof(Node *) + sizeof(double) + sizeof(char));
 
-        dist[src] = 0.0;
+        dist[src->index] = 0.0;
         pq.push({src, 0.0});
-        parent[src] = nullptr;
 
         int iterations = 0;
         while (!pq.empty()) {
@@ -85,23 +120,28 @@ class PathFindingManager {
             Node* current = current_entry.node;
 
             // si el nodo ya fue procesado, saltarlo
-            if (closed_set.find(current) != closed_set.end()) {
+            if (closed_set[current->index]) {
                 continue;
             }
 
             // marcar el nodo como procesado
-            closed_set.insert(current);
+            closed_set[current->index] = true;
 
             iterations++;
 
             /*
             if (iterations % 1000 == 0) {
-                std::cout << "Dijkstra iteration " << iterations << ", queue size: " << pq.size() << std::endl;
+                *log << "Dijkstra iteration " << iterations << ", queue size: " << pq.size() << std::endl;
             }            
             */
 
             if (current == dest) {
-                std::cout << "Dijkstra llego al destino despues de " << iterations << " iteraciones" << std::endl;
+                *log << "Dijkstra llego al destino despues de " << iterations << " iteraciones" << std::endl;
+                stats.settled = iterations;
+                break;
+            }
+
+            if (out_of_budget(iterations, pq.size(), sizeof(Entry))) {
                 break;
             }
 
@@ -117,50 +157,200 @@ class PathFindingManager {
                 if (neighbor == nullptr) continue;
 
                 // no procesar vecinos que ya estan en closed_set
-                if (closed_set.find(neighbor) != closed_set.end()) {
+                if (closed_set[neighbor->index]) {
                     continue;
                 }
 
                 // nueva distancia al vecino
-                double new_dist = dist[current] + edge->length;
+                double new_dist = dist[current->index] + edge->length;
 
                 // si hay un camino mas corto
-                if (new_dist < dist[neighbor]) {
-                    dist[neighbor] = new_dist;
-                    parent[neighbor] = current;
+                if (new_dist < dist[neighbor->index]) {
+                    dist[neighbor->index] = new_dist;
+                    parent[neighbor->index] = current;
 
                     pq.push({neighbor, new_dist});
+                    stats.relaxed++;
 
-                    visited_edges.push_back(sfLine(
-                        current->coord,
-                        neighbor->coord,
-                        sf::Color(100, 100, 255, 100),
-                        1.0f
-                    ));
+                    if (tracing) {
+                        trace.record(edge->index, iterations);
+                    }
+
+                    render(10000);
+                }
+            }
+        }
+
+        if (stats.status == NotRun) {
+            set_final_path(parent);
+        }
+    }
+
+    //* --- arc_flags_dijkstra ---
+    // Igual que 'dijkstra', pero recorre la adyacencia compacta 'graph.forward' y salta los arcos cuya bandera
+    // para la region de 'dest' esta apagada. Si las banderas no existen se calculan en la primera llamada.
+    //*
+    void arc_flags_dijkstra(Graph &graph) {
+        begin_trace(graph, sf::Color(100, 220, 255, 100), 1.0f);
+
+        if (graph.arc_flags.empty()) {
+            *log << "Calculando arc flags..." << std::endl;
+            graph.build_arc_flags();
+        }
+        const ArcFlags &flags = graph.arc_flags;
+        const std::uint8_t target_region = flags.region[dest->index];
+
+        std::vector<Node *> parent(graph.nodes.size(), nullptr);
+        std::vector<double> dist(graph.nodes.size(), std::numeric_limits<double>::max());
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> pq;
+        std::vector<char> closed_set(graph.nodes.size(), false);
+
+        fixed_memory = graph.nodes.size() * (sizeof(Node *) + sizeof(double) + sizeof(char));
+
+        dist[src->index] = 0.0;
+        pq.push({src, 0.0});
+
+        int iterations = 0;
+        while (!pq.empty()) {
+            Node* current = pq.top().node;
+            pq.pop();
+
+            if (closed_set[current->index]) {
+                continue;
+            }
+            closed_set[current->index] = true;
+            iterations++;
+
+            if (current == dest) {
+                *log << "Dijkstra con arc flags llego al destino despues de " << iterations << " iteraciones" << std::endl;
+                stats.settled = iterations;
+                break;
+            }
+
+            if (out_of_budget(iterations, pq.size(), sizeof(Entry))) {
+                break;
+            }
+
+            for (std::size_t a = graph.forward.offsets[current->index]; a < graph.forward.offsets[current->index + 1]; ++a) {
+                // el arco no inicia ningun camino minimo hacia la region de 'dest'
+                if (!flags.allows(a, target_region)) continue;
+
+                const Arc &arc = graph.forward.arcs[a];
+                if (closed_set[arc.to]) continue;
+
+                double new_dist = dist[current->index] + arc.length;
+                if (new_dist < dist[arc.to]) {
+                    Node* neighbor = graph.node_at(arc.to);
+                    dist[arc.to] = new_dist;
+                    parent[arc.to] = current;
+
+                    pq.push({neighbor, new_dist});
+                    stats.relaxed++;
+
+                    if (tracing) {
+                        trace.record(arc.edge, iterations);
+                    }
+
+                    render(10000);
+                }
+            }
+        }
+
+        if (stats.status == NotRun) {
+            set_final_path(parent);
+        }
+    }
+
+    //* --- compressed_dijkstra ---
+    // Dijkstra que lee los arcos directamente de 'graph.compressed' con 'CompressedAdjacency::ArcIterator'
+    // (sin pasar por 'Node::edges' ni 'Edge') y usa distancias enteras en decimetros, por lo que el heap
+    // compara enteros. La adyacencia comprimida se construye en la primera llamada si no existe.
+    //*
+    void compressed_dijkstra(Graph &graph) {
+        begin_trace(graph, sf::Color(200, 200, 200, 100), 1.0f);
+
+        if (graph.compressed.empty()) {
+            graph.build_compressed();
+        }
+        const std::uint64_t inf = std::numeric_limits<std::uint64_t>::max();
+
+        std::vector<Node *> parent(graph.nodes.size(), nullptr);
+        std::vector<std::uint64_t> dist(graph.nodes.size(), inf);
+        std::vector<char> closed_set(graph.nodes.size(), false);
+
+        typedef std::pair<std::uint64_t, std::uint32_t> QueueEntry;
+        std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> pq;
+
+        fixed_memory = graph.nodes.size() * (sizeof(Node *) + sizeof(std::uint64_t) + sizeof(char));
+
+        dist[src->index] = 0;
+        pq.push({0, static_cast<std::uint32_t>(src->index)});
+
+        int iterations = 0;
+        while (!pq.empty()) {
+            std::uint32_t u = pq.top().second;
+            pq.pop();
+
+            if (closed_set[u]) {
+                continue;
+            }
+            closed_set[u] = true;
+            iterations++;
+
+            if (u == dest->index) {
+                *log << "Dijkstra comprimido llego al destino despues de " << iterations << " iteraciones" << std::endl;
+                stats.settled = iterations;
+                break;
+            }
+
+            if (out_of_budget(iterations, pq.size(), sizeof(QueueEntry))) {
+                break;
+            }
+
+            CompressedArc arc {};
+            for (auto it = graph.compressed.arcs(u); it.next(arc);) {
+                if (closed_set[arc.to]) continue;
+
+                std::uint64_t new_dist = dist[u] + arc.weight;
+                if (new_dist < dist[arc.to]) {
+                    dist[arc.to] = new_dist;
+                    parent[arc.to] = graph.node_at(u);
+                    pq.push({new_dist, arc.to});
+                    stats.relaxed++;
+
+                    // la adyacencia comprimida no guarda la arista, solo se busca si hay traza
+                    if (tracing) {
+                        trace.record(edge_between(graph.node_at(u), graph.node_at(arc.to))->index, iterations);
+                    }
 
                     render(10000);
                 }
             }
         }
 
-        set_final_path(parent);
+        if (stats.status == NotRun) {
+            set_final_path(parent);
+        }
     }
 
-    void a_star(Graph &graph) {
-        std::unordered_map<Node *, Node *> parent;
+    // 'heuristic_weight' multiplica la heuristica; 1.0 es el A* clasico
+    void a_star(Graph &graph, double heuristic_weight = 1.0) {
+        begin_trace(graph, sf::Color(100, 255, 100, 100), 1.0f);
+
+        std::vector<Node *> parent(graph.nodes.size(), nullptr);
         
-        // g: distancia desde el origen
-        std::unordered_map<Node*, double> g_score;
+        // g: distancia desde el origen (indexada por 'Node::index')
+        std::vector<double> g_score(graph.nodes.size(), std::numeric_limits<double>::max());
         
         // f: g + heuristica
-        std::unordered_map<Node*, double> f_score;
+        std::vector<double> f_score(graph.nodes.size(), std::numeric_limits<double>::max());
         
         // min-heap de nodos a visitar, ordenados por f_score 
         //(greater se usa para que el menor este arriba)
         std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open_set;
         
-        // Set de nodos ya procesados
-        std::unordered_set<Node*> closed_set;
+        // nodos ya procesados
+        std::vector<char> closed_set(graph.nodes.size(), false);
         
         auto heuristic = [this](Node* node) -> double {
             float dx = node->coord.x - dest->coord.x;
@@ -168,15 +358,11 @@ class PathFindingManager {
             return std::sqrt(dx * dx + dy * dy);
         };
         
-        for (auto& [id, node] : graph.nodes) {
-            g_score[node] = std::numeric_limits<double>::max();
-            f_score[node] = std::numeric_limits<double>::max();
-        }
-        
-        g_score[src] = 0.0;
-        f_score[src] = heuristic(src);
-        open_set.push({src, f_score[src]});
-        parent[src] = nullptr;
+        fixed_memory = graph.nodes.size() * (sizeof(Node *) + 2 * sizeof(double) + sizeof(char));
+
+        g_score[src->index] = 0.0;
+        f_score[src->index] = heuristic_weight * heuristic(src);
+        open_set.push({src, f_score[src->index]});
         
         int iterations = 0;
         while (!open_set.empty()) {
@@ -185,72 +371,69 @@ class PathFindingManager {
             Node* current = current_entry.node;
             
             // si el nodo ya fue procesado, saltarlo (puede haber duplicados en el heap)
-            if (closed_set.find(current) != closed_set.end()) {
+            if (closed_set[current->index]) {
                 continue;
             }
             
             // marcar el nodo como procesado
-            closed_set.insert(current);
+            closed_set[current->index] = true;
             
             iterations++;
             /*
             if (iterations % 1000 == 0) {
-                std::cout << "A* iteration " << iterations << ", open set size: " << open_set.size() << std::endl;
+                *log << "A* iteration " << iterations << ", open set size: " << open_set.size() << std::endl;
             }            
             */
 
             if (current == dest) {
-                std::cout << "A* llego a su destino despues de " << iterations << " iteraciones" << std::endl;
+                *log << "A* llego a su destino despues de " << iterations << " iteraciones" << std::endl;
+                stats.settled = iterations;
+                break;
+            }
+
+            if (out_of_budget(iterations, open_set.size(), sizeof(Entry))) {
                 break;
             }
             
-            for (Edge* edge : current->edges) {
-                Node* neighbor = nullptr;
-                if (edge->src == current) {
-                    neighbor = edge->dest;
-                } else if (!edge->one_way && edge->dest == current) {
-                    neighbor = edge->src;
-                }
-                
-                if (neighbor == nullptr) continue;
-                
-                // no procesar vecinos que ya estan en closed_set
-                if (closed_set.find(neighbor) != closed_set.end()) {
-                    continue;
-                }
-                
-                double tentative_g_score = g_score[current] + edge->length;
+            // vecinos no procesados de 'current', con su heuristica calculada en bloque
+            collect_neighbors(graph, current, closed_set);
+
+            for (std::size_t k = 0; k < neighbors.size(); ++k) {
+                Node* neighbor = neighbors[k].node;
+                double tentative_g_score = g_score[current->index] + neighbors[k].edge->length;
                 
-                if (tentative_g_score < g_score[neighbor]) {
-                    parent[neighbor] = current;
-                    g_score[neighbor] = tentative_g_score;
-                    f_score[neighbor] = g_score[neighbor] + heuristic(neighbor);
+                if (tentative_g_score < g_score[neighbor->index]) {
+                    parent[neighbor->index] = current;
+                    g_score[neighbor->index] = tentative_g_score;
+                    f_score[neighbor->index] = g_score[neighbor->index] + heuristic_weight * neighbor_heuristics[k];
                     
-                    open_set.push({neighbor, f_score[neighbor]});
+                    open_set.push({neighbor, f_score[neighbor->index]});
+                    stats.relaxed++;
                     
-                    visited_edges.push_back(sfLine(
-                        current->coord,
-                        neighbor->coord,
-                        sf::Color(100, 255, 100, 100),
-                        1.0f
-                    ));
+                    if (tracing) {
+                        trace.record(neighbors[k].edge->index, iterations);
+                    }
                     
                     render(10000);
                 }
             }
         }
 
-        set_final_path(parent);
+        if (stats.status == NotRun) {
+            set_final_path(parent);
+        }
     }
 
     void best_first_search(Graph &graph) {
-        std::unordered_map<Node *, Node *> parent;
+        begin_trace(graph, sf::Color(255, 100, 255, 100), 5.0f);  // magenta
+
+        std::vector<Node *> parent(graph.nodes.size(), nullptr);
         
         // Set de nodos a visitar ordenados por heurística
         std::set<Entry> open_set;
         
-        // conjunto de nodos visitados
-        std::unordered_set<Node*> visited;
+        // nodos visitados, indexados por 'Node::index'
+        std::vector<char> visited(graph.nodes.size(), false);
         
         auto heuristic = [this](Node* node) -> double {
             float dx = node->coord.x - dest->coord.x;
@@ -258,9 +441,10 @@ class PathFindingManager {
             return std::sqrt(dx * dx + dy * dy);
         };
         
+        fixed_memory = graph.nodes.size() * (sizeof(Node *) + sizeof(char));
+
         // inicializar el nodo origen
         open_set.insert({src, heuristic(src)});
-        parent[src] = nullptr;
         
         // mientras haya nodos por visitar
         int iterations = 0;
@@ -271,70 +455,335 @@ class PathFindingManager {
             Node* current = current_entry.node;
             
             // marcar como visitado
-            visited.insert(current);
+            visited[current->index] = true;
             
             iterations++;
             /*
             if (iterations % 1000 == 0) {
-                std::cout << "Best-First Search iteration " << iterations << ", open set size: " << open_set.size() << std::endl;
+                *log << "Best-First Search iteration " << iterations << ", open set size: " << open_set.size() << std::endl;
             }            
             */
 
             // si se llega al destino, break
             if (current == dest) {
-                std::cout << "Best-First Search llego a su destino despues de " << iterations << " iteraciones" << std::endl;
+                *log << "Best-First Search llego a su destino despues de " << iterations << " iteraciones" << std::endl;
+                stats.settled = iterations;
+                break;
+            }
+
+            // cada nodo de std::set cuesta aprox. tres punteros y el color ademas de la entrada
+            if (out_of_budget(iterations, open_set.size(), sizeof(Entry) + 4 * sizeof(void *))) {
                 break;
             }
             
-            // se exploran todas las aristas del nodo actual
-            for (Edge* edge : current->edges) {
-                // determinar el nodo vecino segun la direccion de la arista
-                Node* neighbor = nullptr;
-                if (edge->src == current) {
-                    neighbor = edge->dest;
-                } else if (!edge->one_way && edge->dest == current) {
-                    neighbor = edge->src;
-                }
-                
-                if (neighbor == nullptr) continue;
+            // se exploran todas las aristas del nodo actual; la heuristica de los vecinos se calcula en bloque
+            collect_neighbors(graph, current, visited);
+
+            for (std::size_t k = 0; k < neighbors.size(); ++k) {
+                Node* neighbor = neighbors[k].node;
                 
-                // si el vecino no ha sido visitado.
-                if (visited.find(neighbor) == visited.end()) {
-                    // calcular heuristica del vecino
-                    double h = heuristic(neighbor);
+                // si el vecino no ha sido visitado (puede repetirse si hay aristas paralelas).
+                if (!visited[neighbor->index]) {
+                    // heuristica del vecino
+                    double h = neighbor_heuristics[k];
                     
                     // actualizar el padre
-                    parent[neighbor] = current;
+                    parent[neighbor->index] = current;
                     
                     // insertar en el set de los abiertos
                     open_set.insert({neighbor, h});
+                    stats.relaxed++;
                     
                     // marcar en los visitados
-                    visited.insert(neighbor);
+                    visited[neighbor->index] = true;
                     
-                    visited_edges.push_back(sfLine(
-                        current->coord,
-                        neighbor->coord,
-                        sf::Color(255, 100, 255, 100),  // magenta
-                        5.0f
-                    ));
+                    if (tracing) {
+                        trace.record(neighbors[k].edge->index, iterations);
+                    }
                     
                     render(100);
                 }
             }
         }
 
-        set_final_path(parent);
+        if (stats.status == NotRun) {
+            set_final_path(parent);
+        }
+    }
+
+    //* --- anytime_a_star ---
+    // ARA* (Likhachev et al.). Corre A* con la heuristica inflada por w = 1 + anytime_epsilon y, cada vez que
+    // termina, reduce w y continua la busqueda anterior en lugar de empezar de cero: los nodos cuyo g mejora
+    // despues de cerrados se guardan en 'incons' y vuelven a la cola en la siguiente ronda.
+    // Despues de cada ronda la cota publicada es min(w, g(dest) / min{g(s) + h(s) : s en open o incons}).
+    // Si el presupuesto se agota despues de la primera solucion, se devuelve el mejor camino con su cota.
+    // La heuristica se multiplica por 'Graph::heuristic_scale' para que sea admisible y la cota sea valida.
+    //*
+    void anytime_a_star(Graph &graph) {
+        begin_trace(graph, sf::Color(255, 180, 0, 100), 1.0f);
+
+        const double inf = std::numeric_limits<double>::max();
+        const double scale = graph.heuristic_scale;
+
+        std::vector<Node *> parent(graph.nodes.size(), nullptr);
+        std::vector<double> g_score(graph.nodes.size(), inf);
+        std::vector<float> h_score(graph.nodes.size(), -1.0f);  // -1 = aun no calculada
+        std::vector<char> in_open(graph.nodes.size(), false);
+        std::vector<char> closed_set(graph.nodes.size(), false);
+        std::vector<char> in_incons(graph.nodes.size(), false);
+        const std::vector<char> no_skip(graph.nodes.size(), false);  // ARA* tambien actualiza nodos cerrados
+        std::vector<Node *> open_nodes;  // todos los que entraron a open desde la ultima reconstruccion
+        std::vector<Node *> incons;
+
+        // entradas del heap; se descartan si el nodo ya salio de open o si su g cambio
+        struct AnytimeEntry {
+            double key;
+            double g;
+            Node *node;
+
+            bool operator>(const AnytimeEntry &other) const {
+                return key > other.key;
+            }
+        };
+        std::priority_queue<AnytimeEntry, std::vector<AnytimeEntry>, std::greater<AnytimeEntry>> open_set;
+
+        auto heuristic = [&](Node *node) -> double {
+            if (h_score[node->index] < 0.0f) {
+                float dx = node->coord.x - dest->coord.x;
+                float dy = node->coord.y - dest->coord.y;
+                h_score[node->index] = std::sqrt(dx * dx + dy * dy);
+            }
+            return scale * h_score[node->index];
+        };
+
+        double epsilon_now = anytime_epsilon;
+        double weight = 1.0 + epsilon_now;
+        auto push = [&](Node *node) {
+            if (!in_open[node->index]) {
+                in_open[node->index] = true;
+                open_nodes.push_back(node);
+            }
+            double g = g_score[node->index];
+            open_set.push({g + weight * heuristic(node), g, node});
+        };
+
+        fixed_memory = graph.nodes.size() * (sizeof(Node *) + sizeof(double) + sizeof(float) + 3 * sizeof(char));
+
+        g_score[src->index] = 0.0;
+        push(src);
+
+        bool have_solution = false;
+        double bound = inf;
+        int iterations = 0;
+        while (true) {
+            // --- ImprovePath: expandir mientras f(dest) > min f en open ---
+            bool stopped = false;
+            while (!open_set.empty()) {
+                AnytimeEntry top = open_set.top();
+                if (!in_open[top.node->index] || top.g != g_score[top.node->index]) {
+                    open_set.pop();
+                    continue;
+                }
+                if (g_score[dest->index] <= top.key) {
+                    break;
+                }
+                open_set.pop();
+
+                Node *current = top.node;
+                in_open[current->index] = false;
+                closed_set[current->index] = true;
+                iterations++;
+
+                if (out_of_budget(iterations, open_set.size(), sizeof(AnytimeEntry))) {
+                    stopped = true;
+                    break;
+                }
+
+                collect_neighbors(graph, current, no_skip);
+                for (std::size_t k = 0; k < neighbors.size(); ++k) {
+                    Node *neighbor = neighbors[k].node;
+                    double tentative_g_score = g_score[current->index] + neighbors[k].edge->length;
+                    if (tentative_g_score >= g_score[neighbor->index]) continue;
+
+                    g_score[neighbor->index] = tentative_g_score;
+                    parent[neighbor->index] = current;
+                    stats.relaxed++;
+
+                    if (closed_set[neighbor->index]) {
+                        if (!in_incons[neighbor->index]) {
+                            in_incons[neighbor->index] = true;
+                            incons.push_back(neighbor);
+                        }
+                    } else {
+                        push(neighbor);
+                    }
+
+                    if (tracing) {
+                        trace.record(neighbors[k].edge->index, iterations,
+                                     closed_set[neighbor->index] ? ReopenEvent : RelaxEvent);
+                    }
+
+                    render(10000);
+                }
+            }
+
+            if (stopped) {
+                // se conserva la ultima solucion publicada (su cota sigue siendo valida)
+                if (have_solution) {
+                    *log << "ARA* se quedo sin presupuesto, se devuelve la solucion con cota " << bound
+                              << std::endl;
+                    stats.status = Found;
+                }
+                break;
+            }
+
+            if (g_score[dest->index] == inf) {
+                break;
+            }
+
+            // --- publicar la solucion de esta ronda ---
+            double lower = inf;
+            for (Node *node: open_nodes) {
+                if (in_open[node->index]) lower = std::min(lower, g_score[node->index] + heuristic(node));
+            }
+            for (Node *node: incons) {
+                lower = std::min(lower, g_score[node->index] + heuristic(node));
+            }
+            double cost = g_score[dest->index];
+            bound = std::max(1.0, std::min(weight, lower == inf ? 1.0 : cost / lower));
+            have_solution = true;
+
+            path.clear();
+            set_final_path(parent);
+            *log << "ARA* (w = " << weight << "): costo " << cost << ", cota " << bound
+                      << " despues de " << iterations << " iteraciones" << std::endl;
+            render(1);
+
+            if (bound <= 1.0 || epsilon_now == 0.0) {
+                break;
+            }
+
+            // --- siguiente ronda: reducir w, mover incons a open, recalcular las claves ---
+            epsilon_now = epsilon_now / 2 < 0.01 ? 0.0 : epsilon_now / 2;
+            weight = 1.0 + epsilon_now;
+            std::vector<Node *> candidates;
+            candidates.swap(open_nodes);
+            for (Node *node: incons) {
+                in_incons[node->index] = false;
+                in_open[node->index] = true;
+                candidates.push_back(node);
+            }
+            incons.clear();
+            std::sort(candidates.begin(), candidates.end());
+            candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+            open_set = decltype(open_set)();
+            std::fill(closed_set.begin(), closed_set.end(), false);
+            for (Node *node: candidates) {
+                if (in_open[node->index]) {
+                    in_open[node->index] = false;
+                    push(node);
+                }
+            }
+        }
+
+        stats.settled = iterations;
+        if (have_solution) {
+            stats.bound = bound;
+        } else if (stats.status == NotRun) {
+            // 'dest' no es alcanzable
+            set_final_path(parent);
+        }
+    }
+
+    //* --- begin_trace ---
+    // Vacia la traza y fija como se dibuja. La primera vez reserva un evento por arco, lo que alcanza para
+    // Dijkstra y A* (cada arco se relaja a lo mas una vez); la capacidad se conserva entre busquedas.
+    //*
+    void begin_trace(Graph &graph, sf::Color color, float thickness) {
+        trace.begin(color, thickness, tracing ? graph.forward.arcs.size() : 0);
+    }
+
+    // La arista mas corta de 'from' a 'to' (respetando 'one_way'), nullptr si no son vecinos
+    static Edge *edge_between(Node *from, Node *to) {
+        Edge *shortest = nullptr;
+        for (Edge *edge: from->edges) {
+            bool forward = edge->src == from && edge->dest == to;
+            bool backward = !edge->one_way && edge->dest == from && edge->src == to;
+            if ((forward || backward) && (shortest == nullptr || edge->length < shortest->length)) shortest = edge;
+        }
+        return shortest;
+    }
+
+    //* --- out_of_budget ---
+    // Se llama una vez por nodo procesado, con la cantidad de nodos procesados y el tamaño actual de la cola.
+    // Actualiza 'stats' y devuelve true (dejando el motivo en 'stats.status') si la busqueda debe detenerse por
+    // tiempo, nodos, memoria o cancelacion.
+    //*
+    bool out_of_budget(std::size_t settled, std::size_t open_size, std::size_t entry_bytes) {
+        stats.settled = settled;
+        stats.peak_queue = std::max(stats.peak_queue, open_size);
+        stats.memory_bytes = fixed_memory + open_size * entry_bytes + trace.memory_bytes();
+
+        SearchStatus status = guard.check(settled, stats.memory_bytes);
+        if (status == NotRun) {
+            return false;
+        }
+        stats.status = status;
+        *log << "Busqueda detenida (" << to_string(status) << ") despues de " << settled
+                  << " iteraciones" << std::endl;
+        return true;
+    }
+
+    //* --- collect_neighbors ---
+    // Llena 'neighbors' con los vecinos de 'current' alcanzables por sus aristas (respetando 'one_way') que no
+    // esten marcados en 'skip', y 'neighbor_heuristics' con su distancia en linea recta a 'dest'. La heuristica
+    // se evalua para todos los vecinos a la vez con 'SimdKernels::distances' sobre 'Graph::xs' y 'Graph::ys'.
+    //*
+    void collect_neighbors(Graph &graph, Node *current, const std::vector<char> &skip) {
+        neighbors.clear();
+        neighbor_indices.clear();
+        for (Edge *edge: current->edges) {
+            Node *neighbor = nullptr;
+            if (edge->src == current) {
+                neighbor = edge->dest;
+            } else if (!edge->one_way && edge->dest == current) {
+                neighbor = edge->src;
+            }
+
+            if (neighbor == nullptr || skip[neighbor->index]) continue;
+
+            neighbors.push_back({neighbor, edge});
+            neighbor_indices.push_back(static_cast<std::uint32_t>(neighbor->index));
+        }
+
+        neighbor_heuristics.resize(neighbors.size());
+        SimdKernels::distances(graph.xs.data(), graph.ys.data(), neighbor_indices.data(), neighbor_indices.size(),
+                               dest->coord.x, dest->coord.y, neighbor_heuristics.data());
     }
 
     //* --- render ---
     // En cada iteración de los algoritmos esta función es llamada para dibujar los cambios en el 'window_manager'
     void render(int frequency = 100) {
         render_counter++;
-        if (render_counter % frequency != 0) {
+        if (window_manager == nullptr || render_counter % frequency != 0) {
             return;
         }
 
+        // Mientras corre la busqueda el 'main_loop' de la GUI no atiende eventos, asi que aqui se revisa si el
+        // usuario pidio abortar (Escape) o cerro la ventana. El resto de eventos se descarta.
+        sf::Event event{};
+        while (window_manager->poll_event(event)) {
+            bool closed = event.type == sf::Event::Closed;
+            bool escape = event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::Escape;
+            if ((closed || escape) && token != nullptr) {
+                token->cancel();
+            }
+            if (closed) {
+                window_manager->close();
+            }
+        }
+
         window_manager->clear();
 
         // grafo base
@@ -342,8 +791,13 @@ class PathFindingManager {
             current_graph->draw();
         }
 
-        // dibuja todas las aristas visitadas hasta ahora
-        for (sfLine& line : visited_edges) {
+        // dibuja todas las aristas visitadas hasta ahora (por tandas, ver 'ExplorationTrace::draw')
+        if (current_graph != nullptr) {
+            trace.draw(*window_manager, current_graph->edges);
+        }
+
+        // camino parcial (solo existe en los algoritmos 'anytime')
+        for (sfLine& line : path) {
             line.draw(window_manager->get_window(), sf::RenderStates::Default);
         }
 
@@ -357,13 +811,163 @@ class PathFindingManager {
             dest->draw(window_manager->get_window());
         }
 
+        std::size_t endpoints = (src != nullptr) + (dest != nullptr);
+        window_manager->record_draw(path.size() + endpoints,
+                                    path.size() * 4 + endpoints * WindowManager::circle_vertices());
         window_manager->display();
     }
 
+    //* --- add_route_lines ---
+    // Agrega a 'path' las lineas de 'route' siguiendo la forma de cada arista
+    //*
+    void add_route_lines(Graph &graph, const AlternativeRoute &route, sf::Color color, float thickness) {
+        for (std::size_t i = 0; i < route.edges.size(); ++i) {
+            Edge *edge = graph.edges[route.edges[i]];
+            std::vector<sf::Vector2f> points = edge->points_from(graph.node_at(route.nodes[i]));
+            for (std::size_t j = 1; j < points.size(); ++j) {
+                path.push_back(sfLine(points[j - 1], points[j], color, thickness));
+            }
+        }
+    }
+
+    //* --- nearest_targets ---
+    // Dijkstra desde 'src' sobre 'Graph::forward' que se detiene al procesar el k-esimo objetivo alcanzable.
+    // Cada objetivo procesado deja en 'routes' su camino desde 'src' (el primero es el mas cercano).
+    //*
+    void nearest_targets(Graph &graph, const std::vector<std::uint32_t> &targets, std::size_t k) {
+        begin_trace(graph, sf::Color(255, 120, 120, 100), 1.0f);
+
+        const std::uint32_t none = std::numeric_limits<std::uint32_t>::max();
+        std::size_t n = graph.nodes.size();
+        std::vector<double> dist(n, std::numeric_limits<double>::max());
+        std::vector<std::uint32_t> parent(n, none);
+        std::vector<std::uint32_t> parent_edge(n, none);
+        std::vector<char> closed_set(n, false);
+        std::vector<char> is_target(n, false);
+
+        fixed_memory = n * (sizeof(double) + 2 * sizeof(std::uint32_t) + 2 * sizeof(char));
+
+        // los objetivos de otra componente se descartan sin buscar (ver 'Components::may_reach')
+        auto s = static_cast<std::uint32_t>(src->index);
+        std::size_t reachable = 0;
+        for (std::uint32_t target: targets) {
+            if (!is_target[target] && graph.components.may_reach(s, target)) {
+                is_target[target] = true;
+                reachable++;
+            }
+        }
+        k = std::min(k, reachable);
+        if (k == 0) {
+            *log << "Ningun objetivo es alcanzable desde el origen" << std::endl;
+            stats.status = Unreachable;
+            return;
+        }
+
+        typedef std::pair<double, std::uint32_t> QueueEntry;
+        std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> pq;
+        dist[s] = 0.0;
+        pq.push({0.0, s});
+
+        int iterations = 0;
+        while (!pq.empty()) {
+            auto [d, u] = pq.top();
+            pq.pop();
+            if (closed_set[u]) continue;
+            closed_set[u] = true;
+            iterations++;
+
+            if (is_target[u]) {
+                AlternativeRoute route;
+                for (std::uint32_t v = u; v != s; v = parent[v]) {
+                    route.nodes.push_back(v);
+                    route.edges.push_back(parent_edge[v]);
+                }
+                route.nodes.push_back(s);
+                std::reverse(route.nodes.begin(), route.nodes.end());
+                std::reverse(route.edges.begin(), route.edges.end());
+                route.length = d;
+                routes.push_back(std::move(route));
+
+                if (routes.size() == k) {
+                    *log << "Busqueda de objetivos cercanos termino despues de " << iterations << " iteraciones"
+                         << std::endl;
+                    break;
+                }
+            }
+
+            if (out_of_budget(iterations, pq.size(), sizeof(QueueEntry))) {
+                break;
+            }
+
+            for (const Arc *arc = graph.forward.begin(u); arc != graph.forward.end(u); ++arc) {
+                if (closed_set[arc->to]) continue;
+
+                double new_dist = d + arc->length;
+                if (new_dist < dist[arc->to]) {
+                    dist[arc->to] = new_dist;
+                    parent[arc->to] = u;
+                    parent_edge[arc->to] = arc->edge;
+                    pq.push({new_dist, arc->to});
+                    stats.relaxed++;
+
+                    if (tracing) {
+                        trace.record(arc->edge, iterations);
+                    }
+
+                    render(10000);
+                }
+            }
+        }
+        stats.settled = iterations;
+    }
+
+    // Color de la ruta 'r' de 'routes' (la primera en amarillo, como en 'set_final_path')
+    static sf::Color route_color(std::size_t r) {
+        static const sf::Color palette[] = {
+                sf::Color::Yellow,
+                sf::Color(255, 100, 255),
+                sf::Color(255, 140, 0),
+                sf::Color(100, 160, 255),
+                sf::Color(120, 230, 120),
+                sf::Color::White,
+        };
+        return palette[r % (sizeof(palette) / sizeof(palette[0]))];
+    }
+
+    //* --- hub_label_query ---
+    // Distancia de 'src' a 'dest' mezclando las etiquetas de ambos (sin recorrer el grafo) y camino
+    // desempaquetado de las aristas guardadas en las etiquetas. Las etiquetas se cargan o calculan la primera vez.
+    //*
+    void hub_label_query(Graph &graph) {
+        if (graph.hub_labels.empty()) {
+            *log << "Preparando hub labels..." << std::endl;
+            graph.build_hub_labels();
+        }
+
+        auto u = static_cast<std::uint32_t>(src->index), v = static_cast<std::uint32_t>(dest->index);
+        auto start = std::chrono::steady_clock::now();
+        double distance = graph.hub_labels.distance(u, v);
+        std::chrono::duration<double, std::micro> query = std::chrono::steady_clock::now() - start;
+        *log << "Consulta de distancia: " << query.count() << " us" << std::endl;
+
+        AlternativeRoute route;
+        if (distance == HubLabels::infinity ||
+            !graph.hub_labels.unpack(u, v, graph.edges, route.nodes, route.edges)) {
+            *log << "No se encontro un camino al destino" << std::endl;
+            stats.status = Unreachable;
+            return;
+        }
+
+        add_route_lines(graph, route, sf::Color::Yellow, 2.0f);
+        path_ids = route.osm_ids(graph);
+        stats.status = Found;
+        stats.cost = distance;
+    }
+
     //* --- set_final_path ---
     // Esta función se usa para asignarle un valor a 'this->path' al final de la simulación del algoritmo.
-    // 'parent' es un std::unordered_map que recibe un puntero a un vértice y devuelve el vértice anterior a el,
-    // formando así el 'path'.
+    // 'parent' es un std::vector indexado por 'Node::index' que devuelve el vértice anterior a cada vértice
+    // (nullptr si no fue alcanzado o si es 'src'), formando así el 'path'.
     //
     // ej.
     //     parent(a): b
@@ -375,87 +979,275 @@ class PathFindingManager {
     //
     // Este path será utilizado para hacer el 'draw()' del 'path' entre 'src' y 'dest'.
     //*
-    void set_final_path(std::unordered_map<Node *, Node *> &parent) {
+    void set_final_path(const std::vector<Node *> &parent) {
         // ¿el nodo es alcanzable?
-        if (parent.find(dest) == parent.end()) {
-            std::cout << "No se encontro un camino al destino" << std::endl;
+        if (dest != src && parent[dest->index] == nullptr) {
+            *log << "No se encontro un camino al destino" << std::endl;
+            stats.status = Unreachable;
             return;
         }
 
+        path_ids.clear();
         Node* current = dest;
         double total_distance = 0.0;
+        double total_cost = 0.0;
 
         // reconstruccion del camino desde destino a source con el mapa de padres
 
-        while (current != nullptr && parent.find(current) != parent.end()) {
-            Node* prev = parent[current];
+        while (current != nullptr && current != src) {
+            Node* prev = parent[current->index];
 
             if (prev != nullptr) {
-                // distancia euclidiana
-                float dx = current->coord.x - prev->coord.x;
-                float dy = current->coord.y - prev->coord.y;
-                total_distance += std::sqrt(dx * dx + dy * dy);
-                
-                // agregar la linea color amarillo
-                path.push_back(sfLine(
-                    prev->coord,
-                    current->coord,
-                    sf::Color::Yellow,
-                    2.0f
-                ));
+                // la arista mas corta de 'prev' a 'current' es la que uso la busqueda
+                Edge *used = edge_between(prev, current);
+                total_cost += used->length;
+
+                // se recorre la forma de la arista (los nodos contraidos quedan en 'shape')
+                std::vector<sf::Vector2f> points = used->points_from(prev);
+                for (std::size_t i = points.size() - 1; i > 0; --i) {
+                    // distancia euclidiana
+                    sf::Vector2f delta = points[i] - points[i - 1];
+                    total_distance += std::sqrt(delta.x * delta.x + delta.y * delta.y);
+
+                    // agregar la linea color amarillo
+                    path.push_back(sfLine(
+                        points[i - 1],
+                        points[i],
+                        sf::Color::Yellow,
+                        2.0f
+                    ));
+                }
+
+                // ids de OSM de 'current' hacia atras, incluyendo los nodos contraidos
+                path_ids.push_back(current->id);
+                if (used->src == prev) {
+                    path_ids.insert(path_ids.end(), used->via.rbegin(), used->via.rend());
+                } else {
+                    path_ids.insert(path_ids.end(), used->via.begin(), used->via.end());
+                }
             }
 
             current = prev;
         }
         
-        std::cout << "Path length (Euclidean): " << total_distance << " units" << std::endl;
+        path_ids.push_back(src->id);
+        std::reverse(path_ids.begin(), path_ids.end());
+
+        *log << "Path length (Euclidean): " << total_distance << " units" << std::endl;
+        stats.status = Found;
+        stats.path_length = total_distance;
+        stats.cost = total_cost;
     }
 
 public:
     Node *src = nullptr;
     Node *dest = nullptr;
+    double epsilon = 0.5;
+    double anytime_epsilon = 2.0;
+    std::ostream *log = &std::cout;
+    bool tracing;
 
-    explicit PathFindingManager(WindowManager *window_manager) : window_manager(window_manager) {}
+    explicit PathFindingManager(WindowManager *window_manager)
+            : window_manager(window_manager), tracing(window_manager != nullptr) {}
 
-    void exec(Graph &graph, Algorithm algorithm) {
+    //* --- exec ---
+    // Ejecuta 'algorithm' de 'src' a 'dest'. La busqueda se detiene antes de tiempo si se agota 'budget' o si
+    // 'token' es cancelado (en la GUI, con Escape); en ese caso no hay 'path' y 'stats.status' indica el motivo.
+    //*
+    SearchStats exec(Graph &graph, Algorithm algorithm, const SearchBudget &budget = SearchBudget(),
+                     CancellationToken *token = nullptr) {
         if (src == nullptr || dest == nullptr) {
-            return;
+            return stats;
         }
 
-        std::cout << "Iniciando algoritmo desde el nodo " << src->id << " hasta el nodo " << dest->id << std::endl;
+        *log << "Iniciando algoritmo desde el nodo " << src->id << " hasta el nodo " << dest->id << std::endl;
         
         current_graph = &graph;
         path.clear();
-        visited_edges.clear();
+        path_ids.clear();
+        routes.clear();
+        trace.clear();
         render_counter = 0;
+        stats = SearchStats();
+        guard = BudgetGuard(budget, token);
+        this->token = token;
+
+        // Rechazo en O(1) de los pares sin camino (componentes distintas, ver 'components.h')
+        if (!graph.components.may_reach(src->index, dest->index)) {
+            *log << "No se encontro un camino al destino (esta en otra componente)" << std::endl;
+            stats.status = Unreachable;
+            stats.print(*log);
+            return stats;
+        }
 
         // ejecutar algoritmo
         switch (algorithm) {
             case Dijkstra:
-                std::cout << "Ejecutando algoritmo Dijkstra..." << std::endl;
+                *log << "Ejecutando algoritmo Dijkstra..." << std::endl;
                 dijkstra(graph);
-                std::cout << "Dijkstra encontro camino con " << path.size() << " segmentos" << std::endl;
+                *log << "Dijkstra encontro camino con " << path.size() << " segmentos" << std::endl;
                 break;
             case AStar:
-                std::cout << "Ejecutando algoritmo A*..." << std::endl;
+                *log << "Ejecutando algoritmo A*..." << std::endl;
                 a_star(graph);
-                std::cout << "A* encontro camino con " << path.size() << " segmentos" << std::endl;
+                *log << "A* encontro camino con " << path.size() << " segmentos" << std::endl;
                 break;
             case BestFirstSearch:
-                std::cout << "Ejecutando algoritmo Best-First Search..." << std::endl;
+                *log << "Ejecutando algoritmo Best-First Search..." << std::endl;
                 best_first_search(graph);
-                std::cout << "Best-First Search encontro camino con " << path.size() << " segmentos" << std::endl;
+                *log << "Best-First Search encontro camino con " << path.size() << " segmentos" << std::endl;
+                break;
+            case WeightedAStar:
+                *log << "Ejecutando algoritmo A* ponderado (epsilon = " << epsilon << ")..." << std::endl;
+                a_star(graph, (1.0 + epsilon) * graph.heuristic_scale);
+                if (stats.status == Found) stats.bound = 1.0 + epsilon;
+                *log << "A* ponderado encontro camino con " << path.size() << " segmentos" << std::endl;
+                break;
+            case ArcFlagsDijkstra:
+                *log << "Ejecutando algoritmo Dijkstra con arc flags..." << std::endl;
+                arc_flags_dijkstra(graph);
+                *log << "Dijkstra con arc flags encontro camino con " << path.size() << " segmentos" << std::endl;
+                break;
+            case CompressedDijkstra:
+                *log << "Ejecutando algoritmo Dijkstra sobre la adyacencia comprimida..." << std::endl;
+                compressed_dijkstra(graph);
+                *log << "Dijkstra comprimido encontro camino con " << path.size() << " segmentos" << std::endl;
+                break;
+            case HubLabelQuery:
+                *log << "Ejecutando consulta por hub labels..." << std::endl;
+                hub_label_query(graph);
+                *log << "Hub labels encontraron camino con " << path.size() << " segmentos" << std::endl;
+                break;
+            case AnytimeAStar:
+                *log << "Ejecutando algoritmo ARA* (epsilon inicial = " << anytime_epsilon << ")..." << std::endl;
+                anytime_a_star(graph);
+                *log << "ARA* encontro camino con " << path.size() << " segmentos" << std::endl;
                 break;
             default:
                 break;
         }
         
         current_graph = nullptr;
+        this->token = nullptr;
+        stats.elapsed_ms = guard.elapsed_ms();
+        stats.print(*log);
+        return stats;
+    }
+
+    //* --- alternatives ---
+    // Calcula hasta 'options.k' rutas de 'src' a 'dest' con 'AlternativeRoutes' (dos busquedas en total, ver
+    // 'alternative_routes.h') y las deja en 'path', cada una de un color. La optima va en amarillo, como en
+    // 'set_final_path', y se dibuja al final para que quede encima de las alternativas.
+    //*
+    SearchStats alternatives(Graph &graph, const AlternativeRouteOptions &options = AlternativeRouteOptions()) {
+        if (src == nullptr || dest == nullptr) {
+            return stats;
+        }
+
+        *log << "Buscando hasta " << options.k << " rutas desde el nodo " << src->id << " hasta el nodo "
+             << dest->id << std::endl;
+
+        path.clear();
+        path_ids.clear();
+        trace.clear();
+        stats = SearchStats();
+        guard = BudgetGuard(SearchBudget(), nullptr);
+
+        routes = AlternativeRoutes::compute(graph, static_cast<std::uint32_t>(src->index),
+                                            static_cast<std::uint32_t>(dest->index), options, &stats.settled);
+        stats.elapsed_ms = guard.elapsed_ms();
+        if (routes.empty()) {
+            *log << "No se encontro un camino al destino" << std::endl;
+            stats.status = Unreachable;
+            stats.print(*log);
+            return stats;
+        }
+
+        for (std::size_t r = routes.size(); r-- > 0;) {
+            const AlternativeRoute &route = routes[r];
+            add_route_lines(graph, route, route_color(r), r == 0 ? 2.0f : 3.0f);
+
+            *log << "Ruta " << r << ": longitud " << route.length << " (x" << route.length / routes[0].length
+                 << "), comparte " << route.sharing << ", meseta " << route.plateau << std::endl;
+        }
+
+        path_ids = routes[0].osm_ids(graph);
+        stats.status = Found;
+        stats.cost = routes[0].length;
+        stats.print(*log);
+        return stats;
+    }
+
+    //* --- nearest ---
+    // Rutas de 'src' a los 'k' objetivos de 'targets' ('Node::index') mas cercanos, con una sola busqueda que
+    // termina al procesar el k-esimo (ver 'nearest_targets'); no usa 'dest'. Las rutas quedan en 'routes' y en
+    // 'path' con los colores de 'alternatives', y 'path_ids' y 'stats.cost' corresponden al mas cercano. Si el
+    // presupuesto se agota se conservan los objetivos encontrados hasta entonces.
+    //*
+    SearchStats nearest(Graph &graph, const std::vector<std::uint32_t> &targets, std::size_t k = 1,
+                        const SearchBudget &budget = SearchBudget(), CancellationToken *token = nullptr) {
+        if (src == nullptr) {
+            return stats;
+        }
+
+        *log << "Buscando los " << k << " objetivos mas cercanos (de " << targets.size() << ") al nodo " << src->id
+             << std::endl;
+
+        current_graph = &graph;
+        path.clear();
+        path_ids.clear();
+        routes.clear();
+        trace.clear();
+        render_counter = 0;
+        stats = SearchStats();
+        guard = BudgetGuard(budget, token);
+        this->token = token;
+
+        nearest_targets(graph, targets, k);
+
+        for (std::size_t r = routes.size(); r-- > 0;) {
+            const AlternativeRoute &route = routes[r];
+            add_route_lines(graph, route, route_color(r), r == 0 ? 2.0f : 3.0f);
+
+            *log << "Objetivo " << r << ": nodo " << graph.node_at(route.nodes.back())->id << ", costo "
+                 << route.length << std::endl;
+        }
+        if (!routes.empty()) {
+            path_ids = routes[0].osm_ids(graph);
+            stats.cost = routes[0].length;
+            if (stats.status == NotRun) stats.status = Found;
+        } else if (stats.status == NotRun) {
+            stats.status = Unreachable;
+        }
+
+        current_graph = nullptr;
+        this->token = nullptr;
+        stats.elapsed_ms = guard.elapsed_ms();
+        stats.print(*log);
+        return stats;
+    }
+
+    const std::vector<AlternativeRoute> &last_routes() const {
+        return routes;
+    }
+
+    const SearchStats &last_stats() const {
+        return stats;
+    }
+
+    const std::vector<std::size_t> &path_node_ids() const {
+        return path_ids;
+    }
+
+    // Traza de la ultima busqueda; la GUI la guarda, la carga de un archivo y la repite
+    ExplorationTrace &exploration() {
+        return trace;
     }
 
     void reset() {
         path.clear();
-        visited_edges.clear();
+        trace.clear();
+        routes.clear();
 
         if (src) {
             src->reset();
@@ -469,12 +1261,18 @@ public:
         }
     }
 
-    void draw(bool draw_extra_lines) {
-        // Dibujar todas las aristas visitadas
+    //* --- draw ---
+    // Dibuja el camino y los extremos. Si 'draw_extra_lines' es verdadero dibuja tambien los primeros
+    // 'trace_events' eventos de la traza (todos por defecto; la repeticion de la GUI pasa menos). Con
+    // 'draw_extra_lines' en falso se liberan los vertices de la traza, los eventos se conservan.
+    //*
+    void draw(const Graph &graph, bool draw_extra_lines,
+              std::size_t trace_events = std::numeric_limits<std::size_t>::max()) {
+        // Dibujar las aristas visitadas
         if (draw_extra_lines) {
-            for (sfLine &line: visited_edges) {
-                line.draw(window_manager->get_window(), sf::RenderStates::Default);
-            }
+            trace.draw(*window_manager, graph.edges, trace_events);
+        } else {
+            trace.release_geometry();
         }
 
         // Dibujar el camino resultante entre 'str' y 'dest'
@@ -491,6 +1289,10 @@ public:
         if (dest != nullptr) {
             dest->draw(window_manager->get_window());
         }
+
+        std::size_t endpoints = (src != nullptr) + (dest != nullptr);
+        window_manager->record_draw(path.size() + endpoints,
+                                    path.size() * 4 + endpoints * WindowManager::circle_vertices());
     }
 };
 
@@ -0,0 +1,1310 @@
+//
+// Created by juan-diego on 3/29/24.
+//
+
+#ifndef HOMEWORK_GRAPH_ROUTING_SERVER_H
+#define HOMEWORK_GRAPH_ROUTING_SERVER_H
+
+#include "graph.h"
+#include "path_finding_manager.h"
+#include "shortest_path_tree.h"
+#include "multi_source_dijkstra.h"
+#include "facility_set.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define HOMEWORK_GRAPH_ROUTING_SERVER 1
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+
+// *
+// ---- JsonLine ----
+// Objeto JSON de una sola linea, lo minimo que necesita el protocolo del servidor: un objeto plano cuyos
+// valores son strings, numeros, true/false/null o arreglos de numeros. Los numeros se guardan como texto para
+// no perder precision con los ids de OSM.
+//
+// Variables miembro
+//     - values        : Valor de cada clave (strings ya sin comillas ni escapes)
+//     - raw           : Texto JSON original de cada valor escalar, para devolverlo tal cual (ej. "id")
+//     - arrays        : Elementos de cada clave cuyo valor es un arreglo
+//
+// Funciones miembro
+//     - parse         : Lee una linea; devuelve false y llena 'error' si no es un objeto valido
+//     - text / number / integer: Acceso tipado a 'values'
+//     - escape        : Escapa un string para escribirlo en una respuesta
+// *
+struct JsonLine {
+    std::map<std::string, std::string> values;
+    std::map<std::string, std::string> raw;
+    std::map<std::string, std::vector<std::string>> arrays;
+
+    bool parse(const std::string &line, std::string &error) {
+        std::size_t i = 0;
+        skip_spaces(line, i);
+        if (i >= line.size() || line[i] != '{') return fail(error, "se esperaba '{'");
+        i++;
+        skip_spaces(line, i);
+        if (i < line.size() && line[i] == '}') return true;
+
+        while (true) {
+            std::string key;
+            skip_spaces(line, i);
+            if (!read_string(line, i, key)) return fail(error, "se esperaba una clave entre comillas");
+            skip_spaces(line, i);
+            if (i >= line.size() || line[i] != ':') return fail(error, "se esperaba ':' despues de \"" + key + "\"");
+            i++;
+            skip_spaces(line, i);
+
+            if (i < line.size() && line[i] == '[') {
+                i++;
+                std::vector<std::string> &items = arrays[key];
+                skip_spaces(line, i);
+                if (i < line.size() && line[i] == ']') {
+                    i++;
+                } else {
+                    while (true) {
+                        skip_spaces(line, i);
+                        std::string item;
+                        if (!read_scalar(line, i, item)) return fail(error, "arreglo invalido en \"" + key + "\"");
+                        items.push_back(item);
+                        skip_spaces(line, i);
+                        if (i < line.size() && line[i] == ',') { i++; continue; }
+                        if (i < line.size() && line[i] == ']') { i++; break; }
+                        return fail(error, "se esperaba ',' o ']' en \"" + key + "\"");
+                    }
+                }
+            } else {
+                std::size_t start = i;
+                std::string value;
+                if (!read_scalar(line, i, value)) return fail(error, "valor invalido en \"" + key + "\"");
+                values[key] = value;
+                raw[key] = line.substr(start, i - start);
+            }
+
+            skip_spaces(line, i);
+            if (i < line.size() && line[i] == ',') { i++; continue; }
+            if (i < line.size() && line[i] == '}') { i++; break; }
+            return fail(error, "se esperaba ',' o '}'");
+        }
+
+        skip_spaces(line, i);
+        if (i != line.size()) return fail(error, "texto sobrante despues del objeto");
+        return true;
+    }
+
+    std::string text(const std::string &key, const std::string &fallback = "") const {
+        auto it = values.find(key);
+        return it == values.end() ? fallback : it->second;
+    }
+
+    bool number(const std::string &key, double &out) const {
+        auto it = values.find(key);
+        return it != values.end() && to_number(it->second, out);
+    }
+
+    bool integer(const std::string &key, std::size_t &out) const {
+        auto it = values.find(key);
+        return it != values.end() && to_integer(it->second, out);
+    }
+
+    static bool to_number(const std::string &token, double &out) {
+        if (token.empty()) return false;
+        char *end = nullptr;
+        out = std::strtod(token.c_str(), &end);
+        return *end == '\0';
+    }
+
+    static bool to_integer(const std::string &token, std::size_t &out) {
+        if (token.empty() || token[0] == '-') return false;
+        char *end = nullptr;
+        out = std::strtoull(token.c_str(), &end, 10);
+        return *end == '\0';
+    }
+
+    static std::string escape(const std::string &text) {
+        std::string escaped;
+        for (char c: text) {
+            if (c == '"' || c == '\\') {
+                escaped += '\\';
+                escaped += c;
+            } else if (c == '\n') {
+                escaped += "\\n";
+            } else if (static_cast<unsigned char>(c) >= 0x20) {
+                escaped += c;
+            }
+        }
+        return escaped;
+    }
+
+private:
+    static bool fail(std::string &error, const std::string &message) {
+        error = message;
+        return false;
+    }
+
+    static void skip_spaces(const std::string &line, std::size_t &i) {
+        while (i < line.size() && (line[i] == ' ' || line[i] == '\t' || line[i] == '\r')) i++;
+    }
+
+    static bool read_string(const std::string &line, std::size_t &i, std::string &out) {
+        if (i >= line.size() || line[i] != '"') return false;
+        i++;
+        while (i < line.size() && line[i] != '"') {
+            if (line[i] == '\\') {
+                if (++i >= line.size()) return false;
+                switch (line[i]) {
+                    case 'n': out += '\n'; break;
+                    case 't': out += '\t'; break;
+                    case '"': case '\\': case '/': out += line[i]; break;
+                    default: return false;  // \uXXXX no hace falta para el protocolo
+                }
+            } else {
+                out += line[i];
+            }
+            i++;
+        }
+        if (i >= line.size()) return false;
+        i++;
+        return true;
+    }
+
+    // string, numero, true, false o null
+    static bool read_scalar(const std::string &line, std::size_t &i, std::string &out) {
+        if (i < line.size() && line[i] == '"') return read_string(line, i, out);
+
+        std::size_t start = i;
+        while (i < line.size() && (std::isalnum(static_cast<unsigned char>(line[i])) || line[i] == '-' ||
+                                   line[i] == '+' || line[i] == '.')) {
+            i++;
+        }
+        out = line.substr(start, i - start);
+        if (out == "true" || out == "false" || out == "null") return true;
+        double ignored;
+        return to_number(out, ignored);
+    }
+};
+
+
+// *
+// ---- ServerCounters ----
+// Contadores del servidor, consultables con el pedido "stats" y escritos en consola al apagarlo.
+//
+// Variables miembro
+//     - connections   : Conexiones aceptadas
+//     - received      : Pedidos leidos de los sockets
+//     - completed     : Pedidos respondidos sin error
+//     - failed        : Pedidos respondidos con "error"
+//     - batches       : Lotes procesados por los workers
+//     - shared        : Pedidos que se respondieron con una busqueda compartida con otro pedido del mismo lote
+//     - queue_depth   : Pedidos esperando en la cola en este momento
+//     - peak_queue    : Mayor 'queue_depth' observado
+//     - dropped       : Conexiones cerradas por no leer sus respuestas (ver 'RoutingServerOptions::send_timeout')
+//
+// La latencia (desde que se lee el pedido hasta que se escribe la respuesta) se guarda en un buffer circular
+// con las ultimas 'latency_window' muestras, de donde salen p50 y p99.
+// *
+struct ServerCounters {
+    static constexpr std::size_t latency_window = 4096;
+
+    std::atomic<std::uint64_t> connections {0};
+    std::atomic<std::uint64_t> received {0};
+    std::atomic<std::uint64_t> completed {0};
+    std::atomic<std::uint64_t> failed {0};
+    std::atomic<std::uint64_t> batches {0};
+    std::atomic<std::uint64_t> shared {0};
+    std::atomic<std::size_t> queue_depth {0};
+    std::atomic<std::size_t> peak_queue {0};
+    std::atomic<std::uint64_t> dropped {0};
+
+    void record_latency(double ms) {
+        std::lock_guard<std::mutex> lock(latency_mutex);
+        if (latencies.size() < latency_window) {
+            latencies.push_back(ms);
+        } else {
+            latencies[next_latency] = ms;
+        }
+        next_latency = (next_latency + 1) % latency_window;
+        max_latency = std::max(max_latency, ms);
+    }
+
+    void enqueued(std::size_t count) {
+        std::size_t depth = queue_depth += count;
+        std::size_t peak = peak_queue.load();
+        while (depth > peak && !peak_queue.compare_exchange_weak(peak, depth)) {}
+    }
+
+    std::string to_json() {
+        std::vector<double> sorted;
+        double max;
+        {
+            std::lock_guard<std::mutex> lock(latency_mutex);
+            sorted = latencies;
+            max = max_latency;
+        }
+        std::sort(sorted.begin(), sorted.end());
+        auto percentile = [&sorted](double p) {
+            if (sorted.empty()) return 0.0;
+            return sorted[std::min(sorted.size() - 1, static_cast<std::size_t>(p * sorted.size()))];
+        };
+
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(3)
+            << "\"connections\":" << connections
+            << ",\"received\":" << received
+            << ",\"completed\":" << completed
+            << ",\"failed\":" << failed
+            << ",\"batches\":" << batches
+            << ",\"shared\":" << shared
+            << ",\"queue_depth\":" << queue_depth
+            << ",\"peak_queue\":" << peak_queue
+            << ",\"dropped\":" << dropped
+            << ",\"latency_p50_ms\":" << percentile(0.50)
+            << ",\"latency_p99_ms\":" << percentile(0.99)
+            << ",\"latency_max_ms\":" << max;
+        return out.str();
+    }
+
+private:
+    std::mutex latency_mutex;
+    std::vector<double> latencies;
+    std::size_t next_latency = 0;
+    double max_latency = 0.0;
+};
+
+
+// Opciones del servidor
+//     - socket_path   : Ruta del socket Unix; si ya existe un archivo ahi se reemplaza
+//     - workers       : Hilos que atienden pedidos, cada uno con su propio 'PathFindingManager'
+//     - max_batch     : Cantidad maxima de pedidos que un worker saca de la cola de una vez
+//     - batch_window  : Cuanto espera un worker a que lleguen mas pedidos antes de procesar un lote incompleto
+//     - batch_lanes   : Origenes de matrices que 'MultiSourceDijkstra' resuelve en una pasada (8 o 16)
+//     - batch_radius  : Distancia maxima (fraccion de la diagonal del grafo) entre origenes de matrices que se
+//                       resuelven juntos; mas lejos el lote es mas lento que las busquedas sueltas. 0 = nunca
+//     - arc_flags     : Si es verdadero, calcula las arc flags al arrancar para aceptar "algorithm":"arcflags"
+//     - hub_labels    : Archivo de hub labels (se calcula y guarda si no existe); vacio = sin pedidos "distance"
+//     - facilities    : csv de objetivos por defecto de los pedidos "nearest" (ver 'facility_set.h')
+//     - max_outbox    : Bytes de respuestas pendientes por conexion; si un cliente acumula mas se lo desconecta
+//     - send_timeout  : Tiempo maximo sin poder escribir nada de las respuestas pendientes antes de desconectar
+struct RoutingServerOptions {
+    std::string socket_path = "/tmp/homework_graph.sock";
+    unsigned workers = std::max(1u, std::thread::hardware_concurrency());
+    std::size_t max_batch = 64;
+    std::chrono::microseconds batch_window {200};
+    std::size_t batch_lanes = 16;
+    double batch_radius = 0.02;
+    bool arc_flags = false;
+    std::string hub_labels;
+    std::string facilities;
+    std::size_t max_outbox = 16 << 20;
+    std::chrono::milliseconds send_timeout {10000};
+};
+
+
+#ifdef HOMEWORK_GRAPH_ROUTING_SERVER
+
+// *
+// ---- RoutingServer ----
+// Servidor local que carga el grafo una sola vez y responde pedidos por un socket Unix. Cada linea que llega es
+// un objeto JSON y cada respuesta es una linea JSON con el mismo "id" (las respuestas de una conexion pueden
+// llegar en otro orden que los pedidos, el "id" sirve para emparejarlas):
+//
+//     {"id":1,"type":"route","src":<id OSM>,"dest":<id OSM>[,"algorithm":"astar"][,"path":false]
+//      [,"time_limit_ms":50]}
+//         -> {"id":1,"status":"encontrado","cost":1234.5,"settled":812,"path":[<ids OSM>]}
+//     {"id":2,"type":"snap","x":512.3,"y":300.1}                    (coordenadas de 'Node::coord')
+//         -> {"id":2,"node":<id OSM>,"x":512.4,"y":299.8}
+//     {"id":3,"type":"matrix","sources":[<ids OSM>],"targets":[<ids OSM>]}
+//         -> {"id":3,"distances":[[0.0,812.3,null],...]}                 (null = sin camino)
+//     {"id":5,"type":"distance","src":<id OSM>,"dest":<id OSM>[,"path":true]}  (solo con hub labels)
+//         -> {"id":5,"distance":1234.5[,"path":[<ids OSM>]]}                    (null = sin camino)
+//     {"id":6,"type":"nearest","src":<id OSM>[,"targets":[<ids OSM>]][,"k":3][,"path":false]}
+//         -> {"id":6,"settled":812,"results":[{"node":<id OSM>,"cost":412.0,"path":[...]},...]}
+//                                  (sin "targets" se usan los de 'facilities'; del mas cercano al mas lejano)
+//     {"id":4,"type":"stats"}
+//         -> {"id":4,"workers":8,"connections":3,...,"latency_p99_ms":1.2}
+//     cualquier error -> {"id":...,"error":"<mensaje>"}
+//
+// Los ids OSM de los nodos de paso que la simplificacion contrajo al cargar siguen siendo validos: la consulta
+// empieza o termina dentro de su arista ('Graph::anchor'). Las rutas con un algoritmo distinto de Dijkstra
+// salen y llegan por el extremo mas cercano de esa arista, las demas consultas prueban ambos extremos.
+//
+// Un hilo acepta conexiones y un hilo por conexion lee las lineas y las encola. Los sockets no bloquean: los
+// workers escriben lo que el socket acepta y dejan el resto en la cola de salida de la conexion, que vacia su
+// hilo lector ('Connection'), asi un cliente que no lee sus respuestas no detiene a ningun worker. Los workers sacan lotes de
+// hasta 'max_batch' pedidos y, dentro de un lote, agrupan por origen las rutas con Dijkstra (el algoritmo por
+// defecto) y las filas de las matrices: cada origen distinto se resuelve con una sola busqueda de uno a muchos
+// ('ShortestPathTree') que se detiene al procesar todos sus destinos. Los origenes de matrices que estan cerca
+// entre si se resuelven de a 'batch_lanes' con 'MultiSourceDijkstra'. Los pedidos "nearest" usan su propia
+// busqueda, que se detiene al procesar el k-esimo objetivo. Las rutas con otros algoritmos usan
+// 'PathFindingManager' sin ventana.
+//
+// El grafo se comparte entre los workers sin bloqueos: todo lo que las busquedas podrian construir de forma
+// perezosa (adyacencia comprimida, arc flags, hub labels) se construye en 'run' antes de aceptar conexiones.
+//
+// Funciones miembro
+//     - run           : Prepara el grafo, abre el socket y atiende hasta recibir SIGINT/SIGTERM o 'stop'
+//     - stop          : Pide que 'run' termine; los pedidos ya encolados se responden antes de cerrar
+//     - get_counters  : Contadores de pedidos, lotes, cola y latencia
+// *
+class RoutingServer {
+    // *
+    // ---- Connection ----
+    // Socket de un cliente, en modo no bloqueante. 'send' (los workers) escribe lo que el socket acepta y deja
+    // el resto en 'outbox'; el hilo lector lo vacia con 'flush' cuando el socket vuelve a aceptar datos, y
+    // 'wake' (un pipe) lo despierta cuando hay algo nuevo. Si 'outbox' supera 'max_outbox' o pasa 'send_timeout'
+    // sin que se escriba nada, la conexion se cierra ('drop') y las respuestas siguientes se descartan.
+    // *
+    struct Connection {
+        int fd;
+        int wake[2] = {-1, -1};
+        std::mutex write_mutex;
+        std::string outbox;
+        std::size_t max_outbox;
+        std::chrono::steady_clock::time_point last_progress;
+        bool closed = false;
+
+        Connection(int fd, std::size_t max_outbox) : fd(fd), max_outbox(max_outbox) {
+            if (::pipe(wake) != 0) {
+                wake[0] = wake[1] = -1;
+            }
+            for (int descriptor: {fd, wake[0], wake[1]}) {
+                if (descriptor >= 0) ::fcntl(descriptor, F_SETFL, ::fcntl(descriptor, F_GETFL) | O_NONBLOCK);
+            }
+        }
+
+        ~Connection() {
+            for (int descriptor: {fd, wake[0], wake[1]}) {
+                if (descriptor >= 0) ::close(descriptor);
+            }
+        }
+
+        void send(const std::string &line) {
+            std::lock_guard<std::mutex> lock(write_mutex);
+            if (closed) return;  // el cliente se fue o se lo desconecto; la respuesta se descarta
+            if (outbox.size() + line.size() > max_outbox) {
+                drop_locked();
+                return;
+            }
+            bool was_empty = outbox.empty();
+            outbox += line;
+            if (!was_empty) return;  // el lector ya esta esperando para escribir
+
+            last_progress = std::chrono::steady_clock::now();
+            write_some();
+            if (!outbox.empty() && wake[1] >= 0) {
+                char signal = 1;
+                ssize_t ignored = ::write(wake[1], &signal, 1);  // pipe lleno: el lector ya tiene aviso
+                (void) ignored;
+            }
+        }
+
+        // Escribe lo pendiente; devuelve false si la conexion quedo cerrada
+        bool flush() {
+            std::lock_guard<std::mutex> lock(write_mutex);
+            write_some();
+            return !closed;
+        }
+
+        bool pending() {
+            std::lock_guard<std::mutex> lock(write_mutex);
+            return !outbox.empty();
+        }
+
+        bool is_closed() {
+            std::lock_guard<std::mutex> lock(write_mutex);
+            return closed;
+        }
+
+        bool stalled(std::chrono::milliseconds timeout) {
+            std::lock_guard<std::mutex> lock(write_mutex);
+            return !outbox.empty() && std::chrono::steady_clock::now() - last_progress > timeout;
+        }
+
+        void drop() {
+            std::lock_guard<std::mutex> lock(write_mutex);
+            drop_locked();
+        }
+
+        void drain_wake() {
+            char signals[64];
+            while (wake[0] >= 0 && ::read(wake[0], signals, sizeof(signals)) > 0) {}
+        }
+
+    private:
+        void write_some() {
+            while (!closed && !outbox.empty()) {
+                ssize_t n = ::write(fd, outbox.data(), outbox.size());
+                if (n < 0 && errno == EINTR) continue;
+                if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+                if (n <= 0) {
+                    closed = true;
+                    outbox.clear();
+                    return;
+                }
+                outbox.erase(0, static_cast<std::size_t>(n));
+                last_progress = std::chrono::steady_clock::now();
+            }
+        }
+
+        void drop_locked() {
+            closed = true;
+            outbox.clear();
+            ::shutdown(fd, SHUT_RDWR);
+        }
+    };
+
+    struct Request {
+        std::shared_ptr<Connection> connection;
+        std::string line;
+        std::chrono::steady_clock::time_point received;
+    };
+
+    struct Reader {
+        std::thread thread;
+        std::shared_ptr<std::atomic<bool>> done;
+        std::weak_ptr<Connection> connection;
+    };
+
+    static constexpr std::size_t max_line = 1 << 20;
+
+    Graph &graph;
+    RoutingServerOptions options;
+    ServerCounters counters;
+    FacilitySet facilities;
+    double batch_distance = 0.0;  // 'batch_radius' en unidades de 'Node::coord'
+
+    std::deque<Request> queue;
+    std::mutex queue_mutex;
+    std::condition_variable queue_cv;
+    std::atomic<bool> stopping {false};
+
+    std::vector<Reader> readers;
+    std::vector<std::thread> workers;
+    int listen_fd = -1;
+
+    static std::atomic<bool> &interrupted() {
+        static std::atomic<bool> flag {false};
+        return flag;
+    }
+
+    static void on_signal(int) {
+        interrupted() = true;
+    }
+
+public:
+    RoutingServer(Graph &graph, RoutingServerOptions options) : graph(graph), options(std::move(options)) {}
+
+    ~RoutingServer() {
+        stop();
+    }
+
+    int run() {
+        if (graph.compressed.empty()) {
+            graph.build_compressed();
+        }
+        if (options.arc_flags && graph.arc_flags.empty()) {
+            graph.build_arc_flags();
+        }
+        if (!options.hub_labels.empty() && graph.hub_labels.empty()) {
+            graph.options.hub_labels_path = options.hub_labels;
+            graph.build_hub_labels();
+        }
+        if (!options.facilities.empty()) {
+            if (!facilities.load_csv(options.facilities, graph)) {
+                std::cerr << "No se pudo leer " << options.facilities << std::endl;
+                return 1;
+            }
+            std::cout << "Cargados " << facilities.size() << " objetivos (" << facilities.skipped
+                      << " filas descartadas, " << facilities.moved << " nodos de paso movidos a un extremo de "
+                      << "su calle)" << std::endl;
+        }
+
+        if (!graph.xs.empty()) {
+            auto [min_x, max_x] = std::minmax_element(graph.xs.begin(), graph.xs.end());
+            auto [min_y, max_y] = std::minmax_element(graph.ys.begin(), graph.ys.end());
+            batch_distance = options.batch_radius * std::hypot(*max_x - *min_x, *max_y - *min_y);
+        }
+
+        if (!open_socket()) return 1;
+
+        interrupted() = false;
+        std::signal(SIGPIPE, SIG_IGN);
+        std::signal(SIGINT, on_signal);
+        std::signal(SIGTERM, on_signal);
+
+        for (unsigned i = 0; i < std::max(1u, options.workers); ++i) {
+            workers.emplace_back(&RoutingServer::worker_loop, this);
+        }
+        std::cout << "Servidor escuchando en " << options.socket_path << " con " << workers.size()
+                  << " workers (Ctrl+C para detener)" << std::endl;
+
+        accept_loop();
+        shutdown();
+
+        std::cout << "Servidor detenido: {" << counters.to_json() << "}" << std::endl;
+        return 0;
+    }
+
+    void stop() {
+        stopping = true;
+        queue_cv.notify_all();
+    }
+
+    ServerCounters &get_counters() {
+        return counters;
+    }
+
+private:
+    bool open_socket() {
+        sockaddr_un address {};
+        address.sun_family = AF_UNIX;
+        if (options.socket_path.size() >= sizeof(address.sun_path)) {
+            std::cerr << "Ruta de socket demasiado larga: " << options.socket_path << std::endl;
+            return false;
+        }
+        std::strncpy(address.sun_path, options.socket_path.c_str(), sizeof(address.sun_path) - 1);
+
+        listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listen_fd < 0) {
+            std::cerr << "No se pudo crear el socket: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        ::unlink(options.socket_path.c_str());
+        if (::bind(listen_fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 ||
+            ::listen(listen_fd, SOMAXCONN) < 0) {
+            std::cerr << "No se pudo escuchar en " << options.socket_path << ": " << std::strerror(errno)
+                      << std::endl;
+            ::close(listen_fd);
+            listen_fd = -1;
+            return false;
+        }
+        return true;
+    }
+
+    void accept_loop() {
+        while (!stopping && !interrupted()) {
+            pollfd descriptor {listen_fd, POLLIN, 0};
+            int ready = ::poll(&descriptor, 1, 200);
+            if (ready <= 0) continue;  // timeout o EINTR: revisar si hay que detenerse
+
+            int fd = ::accept(listen_fd, nullptr, nullptr);
+            if (fd < 0) continue;
+
+            counters.connections++;
+            reap_readers();
+
+            auto connection = std::make_shared<Connection>(fd, options.max_outbox);
+            auto done = std::make_shared<std::atomic<bool>>(false);
+            readers.push_back({std::thread(&RoutingServer::read_loop, this, connection, done), done, connection});
+        }
+    }
+
+    // libera los hilos de las conexiones que ya se cerraron
+    void reap_readers() {
+        auto finished = std::stable_partition(readers.begin(), readers.end(), [](const Reader &reader) {
+            return !*reader.done;
+        });
+        for (auto it = finished; it != readers.end(); ++it) {
+            it->thread.join();
+        }
+        readers.erase(finished, readers.end());
+    }
+
+    void shutdown() {
+        // dejar de leer; los workers terminan de responder lo que ya esta en la cola
+        for (Reader &reader: readers) {
+            if (auto connection = reader.connection.lock()) {
+                ::shutdown(connection->fd, SHUT_RD);
+            }
+        }
+        for (Reader &reader: readers) {
+            reader.thread.join();
+        }
+        readers.clear();
+
+        stop();
+        for (std::thread &worker: workers) {
+            worker.join();
+        }
+        workers.clear();
+
+        ::close(listen_fd);
+        listen_fd = -1;
+        ::unlink(options.socket_path.c_str());
+    }
+
+    //* --- read_loop ---
+    // Hilo de cada conexion: lee lineas y las encola, y vacia la cola de salida de la conexion cuando el socket
+    // acepta datos. Cuando el cliente deja de enviar (o 'shutdown' corta la lectura) sigue hasta escribir las
+    // respuestas de los pedidos que ya estaban encolados: los pedidos pendientes tienen una copia de
+    // 'connection', asi que termina cuando es la unica y no queda nada por escribir.
+    //*
+    void read_loop(std::shared_ptr<Connection> connection, std::shared_ptr<std::atomic<bool>> done) {
+        std::string buffer;
+        char chunk[4096];
+        bool reading = true;
+
+        while (true) {
+            bool pending = connection->pending();
+            if (!reading && !pending && connection.use_count() == 1) break;
+
+            // sin nada que leer ni escribir el socket no se vigila (POLLHUP se reportaria siempre)
+            pollfd descriptors[2] = {
+                    {reading || pending ? connection->fd : -1,
+                     static_cast<short>((reading ? POLLIN : 0) | (pending ? POLLOUT : 0)), 0},
+                    {connection->wake[0], POLLIN, 0}
+            };
+            int ready = ::poll(descriptors, 2, 200);
+            if (ready < 0 && errno != EINTR) break;
+            if (ready > 0 && descriptors[1].revents != 0) connection->drain_wake();
+
+            if (pending) {
+                if (descriptors[0].revents & (POLLOUT | POLLERR | POLLHUP)) {
+                    if (!connection->flush()) break;
+                }
+                if (connection->stalled(options.send_timeout)) {
+                    connection->drop();
+                    counters.dropped++;
+                    break;
+                }
+            }
+            if (!reading || !(descriptors[0].revents & (POLLIN | POLLERR | POLLHUP))) continue;
+
+            ssize_t n = ::read(connection->fd, chunk, sizeof(chunk));
+            if (n < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)) continue;
+            if (n <= 0) {
+                reading = false;
+                continue;
+            }
+            buffer.append(chunk, static_cast<std::size_t>(n));
+
+            std::vector<Request> lines;
+            std::size_t start = 0, end;
+            while ((end = buffer.find('\n', start)) != std::string::npos) {
+                std::string line = buffer.substr(start, end - start);
+                start = end + 1;
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                if (line.empty()) continue;
+                lines.push_back({connection, std::move(line), std::chrono::steady_clock::now()});
+            }
+            buffer.erase(0, start);
+
+            if (buffer.size() > max_line) {
+                connection->send("{\"error\":\"linea demasiado larga\"}\n");
+                reading = false;
+            }
+            if (!lines.empty()) enqueue(lines);
+        }
+        *done = true;
+    }
+
+    void enqueue(std::vector<Request> &lines) {
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            for (Request &request: lines) {
+                queue.push_back(std::move(request));
+            }
+        }
+        counters.received += lines.size();
+        counters.enqueued(lines.size());
+        if (lines.size() == 1) {
+            queue_cv.notify_one();
+        } else {
+            queue_cv.notify_all();
+        }
+    }
+
+    //* --- next_batch ---
+    // Espera a que haya pedidos y saca hasta 'max_batch'. Si hay menos, espera hasta 'batch_window' a que
+    // lleguen mas, asi los pedidos concurrentes de varios clientes terminan en el mismo lote. Devuelve false
+    // cuando el servidor se detiene y la cola quedo vacia.
+    //*
+    bool next_batch(std::vector<Request> &batch) {
+        batch.clear();
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        while (true) {
+            queue_cv.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (queue.empty()) return false;
+
+            if (queue.size() < options.max_batch && !stopping) {
+                queue_cv.wait_for(lock, options.batch_window, [this] {
+                    return stopping || queue.size() >= options.max_batch;
+                });
+            }
+            // otro worker pudo llevarse los pedidos mientras se esperaba
+            if (!queue.empty()) break;
+        }
+
+        // los pedidos de conexiones ya cerradas se descartan sin calcularlos
+        std::size_t taken = 0;
+        while (!queue.empty() && batch.size() < options.max_batch) {
+            Request request = std::move(queue.front());
+            queue.pop_front();
+            taken++;
+            if (!request.connection->is_closed()) batch.push_back(std::move(request));
+        }
+        counters.queue_depth -= taken;
+        return true;
+    }
+
+    void worker_loop() {
+        PathFindingManager manager(nullptr);
+        std::ostream quiet(nullptr);  // sin buffer: descarta los mensajes de progreso
+        manager.log = &quiet;
+        ShortestPathTree tree(graph);
+        MultiSourceDijkstra multi(graph, options.batch_lanes);
+
+        std::vector<Request> batch;
+        while (next_batch(batch)) {
+            if (batch.empty()) continue;
+            counters.batches++;
+            process(batch, manager, tree, multi);
+        }
+    }
+
+    struct RouteJob {
+        std::size_t request;
+        NodeAnchor dest;
+        bool with_path;
+    };
+
+    struct MatrixJob {
+        std::size_t request;
+        std::vector<NodeAnchor> sources;
+        std::vector<NodeAnchor> targets;
+        std::vector<std::uint32_t> target_nodes;  // extremos de 'targets'
+        std::vector<std::vector<double>> rows;
+    };
+
+    typedef std::pair<std::size_t, std::size_t> MatrixRow;  // (indice en 'matrices', fila)
+
+    // Pedidos de un lote que comparten origen: se resuelven con una sola corrida de 'ShortestPathTree'
+    struct SourceGroup {
+        NodeAnchor src;
+        std::vector<std::uint32_t> targets;
+        std::vector<RouteJob> routes;
+        std::vector<MatrixRow> rows;
+    };
+
+    void process(std::vector<Request> &batch, PathFindingManager &manager, ShortestPathTree &tree,
+                 MultiSourceDijkstra &multi) {
+        std::vector<JsonLine> parsed(batch.size());
+        std::map<std::size_t, SourceGroup> groups;                       // por id de OSM del origen
+        std::map<std::uint32_t, std::vector<MatrixRow>> matrix_sources;  // ordenados por 'Node::index'
+        std::vector<MatrixJob> matrices;
+
+        for (std::size_t r = 0; r < batch.size(); ++r) {
+            JsonLine &json = parsed[r];
+            std::string error;
+            if (!json.parse(batch[r].line, error)) {
+                fail(batch[r], json, "JSON invalido: " + error);
+                continue;
+            }
+
+            std::string type = json.text("type");
+            if (type == "route") {
+                NodeAnchor src, dest;
+                if (!resolve(json, "src", SourceAnchor, src, error) || !resolve(json, "dest", TargetAnchor, dest, error)) {
+                    fail(batch[r], json, error);
+                    continue;
+                }
+
+                std::string algorithm = json.text("algorithm", "dijkstra");
+                if (algorithm == "dijkstra") {
+                    SourceGroup &group = groups[src.id];
+                    group.src = src;
+                    for (const AnchorEnd &end: dest.ends) group.targets.push_back(end.node);
+                    group.routes.push_back({r, dest, json.text("path") != "false"});
+                } else {
+                    route(batch[r], json, manager, src, dest, algorithm);
+                }
+            } else if (type == "matrix") {
+                MatrixJob matrix {r, {}, {}, {}, {}};
+                if (!resolve_all(json, "sources", SourceAnchor, matrix.sources, error) ||
+                    !resolve_all(json, "targets", TargetAnchor, matrix.targets, error)) {
+                    fail(batch[r], json, error);
+                    continue;
+                }
+                for (const NodeAnchor &target: matrix.targets) {
+                    for (const AnchorEnd &end: target.ends) matrix.target_nodes.push_back(end.node);
+                }
+                matrix.rows.resize(matrix.sources.size());
+
+                // los nodos de paso salen por dos extremos: no entran en las tandas de 'MultiSourceDijkstra'
+                std::size_t m = matrices.size();
+                for (std::size_t row = 0; row < matrix.sources.size(); ++row) {
+                    const NodeAnchor &source = matrix.sources[row];
+                    if (source.contracted()) {
+                        SourceGroup &group = groups[source.id];
+                        group.src = source;
+                        group.targets.insert(group.targets.end(), matrix.target_nodes.begin(), matrix.target_nodes.end());
+                        group.rows.push_back({m, row});
+                    } else {
+                        matrix_sources[source.ends[0].node].push_back({m, row});
+                    }
+                }
+                matrices.push_back(std::move(matrix));
+            } else if (type == "nearest") {
+                nearest(batch[r], json, tree);
+            } else if (type == "distance") {
+                distance(batch[r], json);
+            } else if (type == "snap") {
+                snap(batch[r], json);
+            } else if (type == "stats") {
+                respond(batch[r], json, "\"workers\":" + std::to_string(workers.size()) + "," + counters.to_json());
+            } else {
+                fail(batch[r], json, "tipo de pedido desconocido: \"" + type + "\"");
+            }
+        }
+
+        // los origenes sueltos pasan a 'groups', junto con las rutas del mismo origen
+        batch_matrix_rows(matrix_sources, matrices, groups, multi);
+
+        for (auto &[_, group]: groups) {
+            tree.run(group.src.ends, group.targets);
+            auto reached = [&tree](std::uint32_t v) { return tree.distance(v); };
+            std::size_t users = group.routes.size() + group.rows.size();
+            if (users > 1) counters.shared += users;
+
+            for (const RouteJob &job: group.routes) {
+                const AnchorEnd *end = nullptr;
+                double cost = anchored(group.src, job.dest, reached, end);
+                std::ostringstream body;
+                body << std::fixed << std::setprecision(3);
+                if (cost == std::numeric_limits<double>::max()) {
+                    body << "\"status\":\"" << to_string(Unreachable) << "\"";
+                } else {
+                    body << "\"status\":\"" << to_string(Found) << "\",\"cost\":" << cost
+                         << ",\"settled\":" << tree.settled_count();
+                    if (job.with_path) write_path(body, anchored_path(tree, group.src, job.dest, end));
+                }
+                respond(batch[job.request], parsed[job.request], body.str());
+            }
+
+            for (auto [m, row]: group.rows) {
+                MatrixJob &matrix = matrices[m];
+                std::vector<double> &distances = matrix.rows[row];
+                for (const NodeAnchor &target: matrix.targets) {
+                    const AnchorEnd *end = nullptr;
+                    distances.push_back(anchored(group.src, target, reached, end));
+                }
+            }
+        }
+
+        for (MatrixJob &matrix: matrices) {
+            std::ostringstream body;
+            body << std::fixed << std::setprecision(3) << "\"distances\":[";
+            for (std::size_t row = 0; row < matrix.rows.size(); ++row) {
+                body << (row ? ",[" : "[");
+                for (std::size_t col = 0; col < matrix.rows[row].size(); ++col) {
+                    if (col) body << ",";
+                    double distance = matrix.rows[row][col];
+                    if (distance == std::numeric_limits<double>::max()) {
+                        body << "null";
+                    } else {
+                        body << distance;
+                    }
+                }
+                body << "]";
+            }
+            body << "]";
+            respond(batch[matrix.request], parsed[matrix.request], body.str());
+        }
+    }
+
+    //* --- batch_matrix_rows ---
+    // Recorre los origenes de las matrices en orden de 'Node::index' (orden de Hilbert, los cercanos quedan
+    // juntos) y arma tandas de hasta 'multi.lanes()' origenes a menos de 'batch_distance' del primero de la
+    // tanda. Cada tanda de dos o mas se resuelve con una pasada de 'MultiSourceDijkstra'; los origenes que
+    // quedan solos van a 'groups'.
+    //*
+    void batch_matrix_rows(const std::map<std::uint32_t, std::vector<MatrixRow>> &matrix_sources,
+                           std::vector<MatrixJob> &matrices, std::map<std::size_t, SourceGroup> &groups,
+                           MultiSourceDijkstra &multi) {
+        std::vector<std::uint32_t> chunk;
+        auto flush = [&]() {
+            if (chunk.size() == 1) {
+                SourceGroup &group = groups[graph.node_storage[chunk[0]].id];
+                for (MatrixRow row: matrix_sources.at(chunk[0])) {
+                    group.src = matrices[row.first].sources[row.second];
+                    const std::vector<std::uint32_t> &targets = matrices[row.first].target_nodes;
+                    group.targets.insert(group.targets.end(), targets.begin(), targets.end());
+                    group.rows.push_back(row);
+                }
+            } else if (chunk.size() > 1) {
+                std::vector<std::uint32_t> targets;
+                for (std::uint32_t src: chunk) {
+                    for (MatrixRow row: matrix_sources.at(src)) {
+                        const std::vector<std::uint32_t> &row_targets = matrices[row.first].target_nodes;
+                        targets.insert(targets.end(), row_targets.begin(), row_targets.end());
+                    }
+                }
+                multi.run(chunk, targets);
+
+                for (std::size_t lane = 0; lane < chunk.size(); ++lane) {
+                    auto reached = [&multi, lane](std::uint32_t v) { return multi.distance(lane, v); };
+                    for (auto [m, row]: matrix_sources.at(chunk[lane])) {
+                        std::vector<double> &distances = matrices[m].rows[row];
+                        for (const NodeAnchor &target: matrices[m].targets) {
+                            const AnchorEnd *end = nullptr;
+                            distances.push_back(anchored(matrices[m].sources[row], target, reached, end));
+                        }
+                        counters.shared++;
+                    }
+                }
+            }
+            chunk.clear();
+        };
+
+        for (const auto &[src, rows]: matrix_sources) {
+            if (!chunk.empty()) {
+                sf::Vector2f delta = graph.node_storage[src].coord - graph.node_storage[chunk[0]].coord;
+                bool near = batch_distance > 0.0 && std::hypot(delta.x, delta.y) <= batch_distance;
+                if (!near || chunk.size() == multi.lanes()) flush();
+            }
+            chunk.push_back(src);
+        }
+        flush();
+    }
+
+    // Los nodos de paso entran por su extremo mas cercano ('NodeAnchor::nearest_end'): estas busquedas tienen
+    // un solo origen y un solo destino
+    void route(const Request &request, const JsonLine &json, PathFindingManager &manager, const NodeAnchor &src,
+               const NodeAnchor &dest, const std::string &algorithm) {
+        static const std::map<std::string, Algorithm> algorithms = {
+                {"astar",      AStar},
+                {"bestfirst",  BestFirstSearch},
+                {"weighted",   WeightedAStar},
+                {"anytime",    AnytimeAStar},
+                {"arcflags",   ArcFlagsDijkstra},
+                {"compressed", CompressedDijkstra},
+        };
+        auto found = algorithms.find(algorithm);
+        if (found == algorithms.end()) {
+            fail(request, json, "algoritmo desconocido: \"" + algorithm + "\"");
+            return;
+        }
+        if (found->second == ArcFlagsDijkstra && graph.arc_flags.empty()) {
+            fail(request, json, "arc flags no disponibles (iniciar el servidor con --arc-flags)");
+            return;
+        }
+
+        SearchBudget budget;
+        double limit;
+        if (json.number("time_limit_ms", limit) && limit > 0) {
+            budget.time_limit = std::chrono::milliseconds(static_cast<long long>(limit));
+        }
+
+        const AnchorEnd &src_end = src.nearest_end(), &dest_end = dest.nearest_end();
+        manager.src = graph.node_at(src_end.node);
+        manager.dest = graph.node_at(dest_end.node);
+        SearchStats stats = manager.exec(graph, found->second, budget);
+        manager.src = manager.dest = nullptr;
+
+        std::vector<std::size_t> ids;
+        if (stats.status == Found) {
+            stats.cost += src_end.offset + dest_end.offset;
+            ids = manager.path_node_ids();
+            src.wrap(src_end, SourceAnchor, ids);
+            dest.wrap(dest_end, TargetAnchor, ids);
+        }
+        double direct;
+        std::vector<std::size_t> direct_ids;
+        if (Graph::along_edge(src, dest, direct, direct_ids) && (stats.status != Found || direct < stats.cost)) {
+            stats.status = Found;
+            stats.cost = direct;
+            ids = direct_ids;
+        }
+
+        std::ostringstream body;
+        body << std::fixed << std::setprecision(3) << "\"status\":\"" << to_string(stats.status) << "\"";
+        if (stats.status == Found) {
+            body << ",\"cost\":" << stats.cost << ",\"settled\":" << stats.settled;
+            if (stats.bound > 1.0) body << ",\"bound\":" << stats.bound;
+            if (json.text("path") != "false") write_path(body, ids);
+        }
+        respond(request, json, body.str());
+    }
+
+    // Sin recorrer el grafo: mezcla las etiquetas de 'src' y 'dest' (ver 'hub_labels.h')
+    void distance(const Request &request, const JsonLine &json) {
+        if (graph.hub_labels.empty()) {
+            fail(request, json, "hub labels no disponibles (iniciar el servidor con --hub-labels <archivo>)");
+            return;
+        }
+        NodeAnchor src, dest;
+        std::string error;
+        if (!resolve(json, "src", SourceAnchor, src, error) || !resolve(json, "dest", TargetAnchor, dest, error)) {
+            fail(request, json, error);
+            return;
+        }
+
+        // cada par de extremos de 'src' y 'dest' (a lo mas 4 consultas a las etiquetas)
+        double cost = HubLabels::infinity;
+        const AnchorEnd *src_end = nullptr, *dest_end = nullptr;
+        for (const AnchorEnd &a: src.ends) {
+            for (const AnchorEnd &b: dest.ends) {
+                double d = graph.hub_labels.distance(a.node, b.node);
+                if (d == HubLabels::infinity) continue;
+                if (d + a.offset + b.offset < cost) {
+                    cost = d + a.offset + b.offset;
+                    src_end = &a;
+                    dest_end = &b;
+                }
+            }
+        }
+        double direct;
+        std::vector<std::size_t> ids;
+        bool along = Graph::along_edge(src, dest, direct, ids) && direct < cost;
+        if (along) cost = direct;
+
+        std::ostringstream body;
+        body << std::fixed << std::setprecision(3) << "\"distance\":";
+        if (cost == HubLabels::infinity) {
+            body << "null";
+        } else {
+            body << cost;
+            AlternativeRoute route;
+            if (json.text("path") == "true" && !along &&
+                graph.hub_labels.unpack(src_end->node, dest_end->node, graph.edges, route.nodes, route.edges)) {
+                ids = route.osm_ids(graph);
+                src.wrap(*src_end, SourceAnchor, ids);
+                dest.wrap(*dest_end, TargetAnchor, ids);
+            }
+            if (json.text("path") == "true" && !ids.empty()) write_path(body, ids);
+        }
+        respond(request, json, body.str());
+    }
+
+    // Una busqueda desde 'src' que termina al procesar el k-esimo objetivo ('ShortestPathTree::run' con
+    // 'stop_after'); se atiende antes que los grupos del lote, asi que puede reutilizar 'tree'. Un objetivo que
+    // es nodo de paso tiene hasta dos extremos, asi que con alguno de esos se procesan hasta 2k extremos.
+    void nearest(const Request &request, const JsonLine &json, ShortestPathTree &tree) {
+        NodeAnchor src;
+        std::string error;
+        if (!resolve(json, "src", SourceAnchor, src, error)) {
+            fail(request, json, error);
+            return;
+        }
+
+        std::vector<NodeAnchor> targets;
+        if (json.arrays.count("targets") > 0) {
+            if (!resolve_all(json, "targets", TargetAnchor, targets, error)) {
+                fail(request, json, error);
+                return;
+            }
+        } else if (facilities.empty()) {
+            fail(request, json, "\"nearest\" necesita \"targets\" (o iniciar el servidor con --facilities <csv>)");
+            return;
+        }
+
+        std::size_t k = 1;
+        if (json.values.count("k") > 0 && (!json.integer("k", k) || k == 0)) {
+            fail(request, json, "\"k\" debe ser un entero positivo");
+            return;
+        }
+
+        if (json.arrays.count("targets") == 0) {
+            for (std::uint32_t node: facilities.nodes) {
+                targets.push_back(NodeAnchor());
+                targets.back().id = graph.node_storage[node].id;
+                targets.back().ends.push_back({node, 0.0, {}});
+            }
+        }
+        // 'run' con una lista vacia recorreria todo el grafo
+        if (targets.empty()) {
+            respond(request, json, "\"settled\":0,\"results\":[]");
+            return;
+        }
+        std::vector<std::uint32_t> candidates;
+        bool two_ends = false;
+        for (const NodeAnchor &target: targets) {
+            for (const AnchorEnd &end: target.ends) candidates.push_back(end.node);
+            two_ends = two_ends || target.ends.size() > 1;
+        }
+        tree.run(src.ends, candidates, two_ends ? 2 * k : k);
+        bool with_path = json.text("path") != "false";
+
+        // (costo, objetivo, extremo) de los objetivos con algun extremo procesado, del mas cercano al mas lejano
+        auto reached = [&tree](std::uint32_t v) { return tree.distance(v); };
+        std::vector<std::tuple<double, std::size_t, const AnchorEnd *>> results;
+        for (std::size_t i = 0; i < targets.size(); ++i) {
+            const AnchorEnd *end = nullptr;
+            double cost = anchored(src, targets[i], reached, end);
+            if (cost != std::numeric_limits<double>::max()) results.emplace_back(cost, i, end);
+        }
+        std::sort(results.begin(), results.end(), [](const auto &a, const auto &b) {
+            return std::get<0>(a) < std::get<0>(b);
+        });
+        if (results.size() > k) results.resize(k);
+
+        std::ostringstream body;
+        body << std::fixed << std::setprecision(3) << "\"settled\":" << tree.settled_count() << ",\"results\":[";
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            auto [cost, target, end] = results[i];
+            body << (i ? "," : "") << "{\"node\":" << targets[target].id << ",\"cost\":" << cost;
+            if (with_path) write_path(body, anchored_path(tree, src, targets[target], end));
+            body << "}";
+        }
+        body << "]";
+        respond(request, json, body.str());
+    }
+
+    void snap(const Request &request, const JsonLine &json) {
+        double x, y;
+        if (!json.number("x", x) || !json.number("y", y)) {
+            fail(request, json, "\"snap\" necesita \"x\" e \"y\" numericos");
+            return;
+        }
+        Node *node = graph.nearest(sf::Vector2f(static_cast<float>(x), static_cast<float>(y)));
+        if (node == nullptr) {
+            fail(request, json, "el grafo esta vacio");
+            return;
+        }
+
+        std::ostringstream body;
+        body << std::fixed << std::setprecision(3) << "\"node\":" << node->id << ",\"x\":" << node->coord.x
+             << ",\"y\":" << node->coord.y;
+        respond(request, json, body.str());
+    }
+
+    // Los ids de nodos de paso contraidos al cargar tambien son validos (ver 'Graph::anchor')
+    bool resolve(const JsonLine &json, const std::string &key, AnchorRole role, NodeAnchor &anchor,
+                 std::string &error) const {
+        std::size_t id;
+        if (!json.integer(key, id)) {
+            error = "falta el id de OSM \"" + key + "\"";
+            return false;
+        }
+        if (!graph.anchor(id, role, anchor)) {
+            error = "nodo desconocido: " + std::to_string(id);
+            return false;
+        }
+        return true;
+    }
+
+    bool resolve_all(const JsonLine &json, const std::string &key, AnchorRole role, std::vector<NodeAnchor> &anchors,
+                     std::string &error) const {
+        auto array = json.arrays.find(key);
+        if (array == json.arrays.end()) {
+            error = "falta el arreglo \"" + key + "\"";
+            return false;
+        }
+        for (const std::string &token: array->second) {
+            std::size_t id;
+            anchors.emplace_back();
+            if (!JsonLine::to_integer(token, id) || !graph.anchor(id, role, anchors.back())) {
+                error = "nodo desconocido en \"" + key + "\": " + token;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    //* --- anchored ---
+    // Costo de 'src' a 'dest' dada 'distance(v)': la distancia desde los extremos de 'src' (con su 'offset' ya
+    // sumado) hasta v, o max() si no se alcanzo. Usa el extremo de 'dest' mas barato y lo compara con el tramo
+    // directo ('Graph::along_edge'). 'end' queda en el extremo usado, o en nullptr si gano el tramo directo.
+    //*
+    template<typename Distance>
+    static double anchored(const NodeAnchor &src, const NodeAnchor &dest, Distance distance, const AnchorEnd *&end) {
+        double best = std::numeric_limits<double>::max();
+        end = nullptr;
+        for (const AnchorEnd &candidate: dest.ends) {
+            double d = distance(candidate.node);
+            if (d != std::numeric_limits<double>::max() && d + candidate.offset < best) {
+                best = d + candidate.offset;
+                end = &candidate;
+            }
+        }
+        double direct;
+        std::vector<std::size_t> ids;
+        if (Graph::along_edge(src, dest, direct, ids) && direct < best) {
+            best = direct;
+            end = nullptr;
+        }
+        return best;
+    }
+
+    // Camino de 'src' a 'dest' con el extremo elegido por 'anchored'
+    std::vector<std::size_t> anchored_path(const ShortestPathTree &tree, const NodeAnchor &src,
+                                           const NodeAnchor &dest, const AnchorEnd *end) const {
+        std::vector<std::size_t> ids;
+        if (end == nullptr) {
+            double direct;
+            Graph::along_edge(src, dest, direct, ids);
+            return ids;
+        }
+        ids = tree.path_ids(end->node);
+        // el camino empieza en el extremo de 'src' que le dio su distancia
+        for (const AnchorEnd &start: src.ends) {
+            if (!ids.empty() && graph.node_storage[start.node].id == ids.front()) {
+                src.wrap(start, SourceAnchor, ids);
+                break;
+            }
+        }
+        dest.wrap(*end, TargetAnchor, ids);
+        return ids;
+    }
+
+    static void write_path(std::ostringstream &body, const std::vector<std::size_t> &ids) {
+        body << ",\"path\":[";
+        for (std::size_t i = 0; i < ids.size(); ++i) {
+            if (i) body << ",";
+            body << ids[i];
+        }
+        body << "]";
+    }
+
+    void respond(const Request &request, const JsonLine &json, const std::string &body) {
+        send(request, json, body);
+        counters.completed++;
+    }
+
+    void fail(const Request &request, const JsonLine &json, const std::string &message) {
+        send(request, json, "\"error\":\"" + JsonLine::escape(message) + "\"");
+        counters.failed++;
+    }
+
+    void send(const Request &request, const JsonLine &json, const std::string &body) {
+        std::string line = "{";
+        auto id = json.raw.find("id");
+        if (id != json.raw.end()) {
+            line += "\"id\":" + id->second + ",";
+        }
+        line += body + "}\n";
+        request.connection->send(line);
+
+        std::chrono::duration<double, std::milli> latency = std::chrono::steady_clock::now() - request.received;
+        counters.record_latency(latency.count());
+    }
+};
+
+#endif // HOMEWORK_GRAPH_ROUTING_SERVER
+
+
+#endif //HOMEWORK_GRAPH_ROUTING_SERVER_H
@@ -0,0 +1,158 @@
+//
+// Created by juan-diego on 3/29/24.
+//
+
+#ifndef HOMEWORK_GRAPH_SEARCH_BUDGET_H
+#define HOMEWORK_GRAPH_SEARCH_BUDGET_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+
+
+// Este enum indica como termino la ultima busqueda
+enum SearchStatus {
+    NotRun,          // Aun no se ejecuto ninguna busqueda
+    Found,           // Se encontro un camino a 'dest'
+    Unreachable,     // Se exploro todo lo alcanzable y 'dest' no estaba
+    TimedOut,        // Se agoto 'SearchBudget::time_limit'
+    BudgetExceeded,  // Se agoto 'SearchBudget::max_settled' o 'SearchBudget::max_memory'
+    Cancelled        // Alguien llamo a 'CancellationToken::cancel'
+};
+
+inline const char *to_string(SearchStatus status) {
+    switch (status) {
+        case Found: return "encontrado";
+        case Unreachable: return "inalcanzable";
+        case TimedOut: return "tiempo agotado";
+        case BudgetExceeded: return "presupuesto agotado";
+        case Cancelled: return "cancelado";
+        default: return "sin ejecutar";
+    }
+}
+
+
+// *
+// ---- SearchBudget ----
+// Limites de una busqueda. Un valor de 0 significa "sin limite".
+//
+// Variables miembro
+//     - time_limit    : Tiempo maximo desde que empieza la busqueda
+//     - max_settled   : Cantidad maxima de nodos procesados (sacados de la cola y cerrados)
+//     - max_memory    : Memoria maxima estimada, en bytes, de las estructuras de la busqueda
+// *
+struct SearchBudget {
+    std::chrono::milliseconds time_limit {0};
+    std::size_t max_settled = 0;
+    std::size_t max_memory = 0;
+};
+
+
+// *
+// ---- CancellationToken ----
+// Bandera compartida entre quien lanza la busqueda y quien quiere abortarla (la GUI o, en otro hilo, un
+// servidor). Las busquedas la revisan en cada iteracion de su ciclo principal.
+// *
+class CancellationToken {
+    std::atomic<bool> cancelled {false};
+
+public:
+    void cancel() {
+        cancelled.store(true, std::memory_order_relaxed);
+    }
+
+    void reset() {
+        cancelled.store(false, std::memory_order_relaxed);
+    }
+
+    bool is_cancelled() const {
+        return cancelled.load(std::memory_order_relaxed);
+    }
+};
+
+
+// *
+// ---- SearchStats ----
+// Resumen de la ultima busqueda.
+//
+// Variables miembro
+//     - status        : Como termino la busqueda
+//     - settled       : Nodos procesados
+//     - relaxed       : Aristas que mejoraron la distancia de un vecino
+//     - peak_queue    : Tamaño maximo de la cola de prioridad
+//     - memory_bytes  : Memoria estimada de las estructuras de la busqueda al terminar
+//     - elapsed_ms    : Tiempo total, incluyendo el dibujado intermedio
+//     - path_length   : Longitud euclidiana (en coordenadas) del camino encontrado, 0 si no hay camino
+//     - cost          : Costo del camino encontrado (suma de 'Edge::length'), 0 si no hay camino
+//     - bound         : Cota garantizada de cost / optimo (1 para los algoritmos exactos o sin garantia)
+// *
+struct SearchStats {
+    SearchStatus status = NotRun;
+    std::size_t settled = 0;
+    std::size_t relaxed = 0;
+    std::size_t peak_queue = 0;
+    std::size_t memory_bytes = 0;
+    double elapsed_ms = 0.0;
+    double path_length = 0.0;
+    double cost = 0.0;
+    double bound = 1.0;
+
+    void print(std::ostream &out = std::cout) const {
+        out << "Estado: " << to_string(status)
+            << " | nodos procesados: " << settled
+            << " | relajaciones: " << relaxed
+            << " | cola maxima: " << peak_queue
+            << " | memoria: " << memory_bytes / 1024 << " KiB"
+            << " | costo: " << cost
+            << " | cota: " << bound
+            << " | tiempo: " << elapsed_ms << " ms" << std::endl;
+    }
+};
+
+
+// *
+// ---- BudgetGuard ----
+// Lleva la cuenta de una busqueda en curso y decide si debe detenerse. 'check' es barato: la cancelacion se
+// revisa siempre, pero el reloj solo cada 'clock_interval' llamadas.
+// *
+class BudgetGuard {
+    static constexpr std::size_t clock_interval = 256;
+
+    SearchBudget budget;
+    const CancellationToken *token;
+    std::chrono::steady_clock::time_point start;
+    std::size_t calls = 0;
+
+public:
+    explicit BudgetGuard(const SearchBudget &budget = SearchBudget(), const CancellationToken *token = nullptr)
+            : budget(budget), token(token), start(std::chrono::steady_clock::now()) {}
+
+    // Devuelve 'NotRun' si la busqueda puede continuar, o el motivo por el que debe detenerse
+    SearchStatus check(std::size_t settled, std::size_t memory_bytes) {
+        if (token != nullptr && token->is_cancelled()) {
+            return Cancelled;
+        }
+        if (budget.max_settled != 0 && settled >= budget.max_settled) {
+            return BudgetExceeded;
+        }
+        if (budget.max_memory != 0 && memory_bytes >= budget.max_memory) {
+            return BudgetExceeded;
+        }
+        if (budget.time_limit.count() != 0 && ++calls % clock_interval == 0 && elapsed() >= budget.time_limit) {
+            return TimedOut;
+        }
+        return NotRun;
+    }
+
+    std::chrono::milliseconds elapsed() const {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    }
+
+    double elapsed_ms() const {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+};
+
+
+#endif //HOMEWORK_GRAPH_SEARCH_BUDGET_H
@@ -0,0 +1,172 @@
+//
+// Created by juan-diego on 3/29/24.
+//
+
+#ifndef HOMEWORK_GRAPH_SHORTEST_PATH_TREE_H
+#define HOMEWORK_GRAPH_SHORTEST_PATH_TREE_H
+
+#include "graph.h"
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <queue>
+#include <vector>
+
+
+// *
+// ---- ShortestPathTree ----
+// Dijkstra de uno a muchos sobre 'Graph::forward', sin dibujar nada. Sirve para responder varias consultas
+// con el mismo origen usando una sola busqueda (filas de una matriz, rutas agrupadas por el servidor, etc.).
+// Los arreglos se reutilizan entre corridas: solo se limpian los nodos que la corrida anterior toco, asi que
+// una instancia por hilo evita reservar memoria en cada consulta.
+//
+// Funciones miembro
+//     - run           : Dijkstra desde 'src' hasta procesar todos los 'targets' (o todo el grafo si esta vacio).
+//                       Con 'stop_after' > 0 se detiene al procesar esa cantidad de objetivos: los mas cercanos.
+//                       Tambien acepta varios origenes con una distancia inicial cada uno (los extremos de un
+//                       'NodeAnchor'); el camino de cada nodo empieza en el origen que le dio su distancia
+//     - found         : Objetivos procesados en la ultima corrida, del mas cercano al mas lejano
+//     - reached       : true si la ultima corrida proceso el nodo
+//     - distance      : Distancia de 'src' al nodo (infinito si no fue alcanzado)
+//     - path_ids      : Ids de OSM del camino de 'src' al nodo, incluyendo los nodos contraidos en 'Edge::via'
+//     - settled_count : Nodos procesados en la ultima corrida
+// *
+class ShortestPathTree {
+    const Graph &graph;
+    std::vector<double> dist;
+    std::vector<std::uint32_t> parent_arc;
+    std::vector<char> settled;
+    std::vector<char> is_target;
+    std::vector<std::uint32_t> touched;
+    std::vector<std::uint32_t> found_targets;
+    std::size_t settled_nodes = 0;
+
+    static constexpr std::uint32_t no_arc = std::numeric_limits<std::uint32_t>::max();
+
+public:
+    explicit ShortestPathTree(const Graph &graph)
+            : graph(graph),
+              dist(graph.node_storage.size(), std::numeric_limits<double>::max()),
+              parent_arc(graph.node_storage.size(), no_arc),
+              settled(graph.node_storage.size(), false),
+              is_target(graph.node_storage.size(), false) {}
+
+    void run(std::uint32_t src, const std::vector<std::uint32_t> &targets, std::size_t stop_after = 0) {
+        run(std::vector<AnchorEnd> {{src, 0.0, {}}}, targets, stop_after);
+    }
+
+    void run(const std::vector<AnchorEnd> &sources, const std::vector<std::uint32_t> &targets,
+             std::size_t stop_after = 0) {
+        for (std::uint32_t u: touched) {
+            dist[u] = std::numeric_limits<double>::max();
+            parent_arc[u] = no_arc;
+            settled[u] = false;
+        }
+        touched.clear();
+        found_targets.clear();
+        settled_nodes = 0;
+        if (sources.empty()) return;
+        // los extremos de un 'NodeAnchor' estan unidos por su arista: tienen las mismas componentes
+        std::uint32_t src = sources[0].node;
+
+        // solo cuentan los objetivos que pueden ser alcanzables (ver 'Components::may_reach')
+        std::size_t remaining = 0;
+        for (std::uint32_t target: targets) {
+            if (!is_target[target] && graph.components.may_reach(src, target)) {
+                is_target[target] = true;
+                remaining++;
+            }
+        }
+        bool all = targets.empty();
+        if (stop_after > 0) remaining = std::min(remaining, stop_after);
+        if (!all && remaining == 0) return;
+
+        typedef std::pair<double, std::uint32_t> QueueEntry;
+        std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> pq;
+        for (const AnchorEnd &source: sources) {
+            if (source.offset >= dist[source.node]) continue;
+            if (dist[source.node] == std::numeric_limits<double>::max()) touched.push_back(source.node);
+            dist[source.node] = source.offset;
+            pq.push({source.offset, source.node});
+        }
+
+        while (!pq.empty()) {
+            auto [d, u] = pq.top();
+            pq.pop();
+            if (settled[u]) continue;
+            settled[u] = true;
+            settled_nodes++;
+
+            if (is_target[u]) {
+                is_target[u] = false;
+                found_targets.push_back(u);
+                if (--remaining == 0 && !all) break;
+            }
+
+            for (std::uint32_t a = graph.forward.offsets[u]; a < graph.forward.offsets[u + 1]; ++a) {
+                const Arc &arc = graph.forward.arcs[a];
+                double candidate = d + arc.length;
+                if (candidate < dist[arc.to]) {
+                    if (dist[arc.to] == std::numeric_limits<double>::max()) touched.push_back(arc.to);
+                    dist[arc.to] = candidate;
+                    parent_arc[arc.to] = a;
+                    pq.push({candidate, arc.to});
+                }
+            }
+        }
+
+        // objetivos que no se alcanzaron
+        for (std::uint32_t target: targets) {
+            is_target[target] = false;
+        }
+    }
+
+    bool reached(std::uint32_t v) const {
+        return settled[v];
+    }
+
+    double distance(std::uint32_t v) const {
+        return settled[v] ? dist[v] : std::numeric_limits<double>::max();
+    }
+
+    const std::vector<std::uint32_t> &found() const {
+        return found_targets;
+    }
+
+    std::size_t settled_count() const {
+        return settled_nodes;
+    }
+
+    std::vector<std::size_t> path_ids(std::uint32_t v) const {
+        std::vector<std::size_t> ids;
+        if (!settled[v]) return ids;
+
+        while (parent_arc[v] != no_arc) {
+            ids.push_back(graph.node_storage[v].id);
+
+            std::uint32_t a = parent_arc[v];
+            const Edge *edge = graph.edges[graph.forward.arcs[a].edge];
+            std::uint32_t u = tail(a);
+            // 'via' va de 'src' a 'dest' de la arista; aqui se recorre de v hacia u
+            if (edge->src->index == u) {
+                ids.insert(ids.end(), edge->via.rbegin(), edge->via.rend());
+            } else {
+                ids.insert(ids.end(), edge->via.begin(), edge->via.end());
+            }
+            v = u;
+        }
+        ids.push_back(graph.node_storage[v].id);
+        std::reverse(ids.begin(), ids.end());
+        return ids;
+    }
+
+private:
+    // nodo del que sale el arco 'a' (busqueda binaria en los offsets del CSR)
+    std::uint32_t tail(std::uint32_t a) const {
+        auto it = std::upper_bound(graph.forward.offsets.begin(), graph.forward.offsets.end(), a);
+        return static_cast<std::uint32_t>(it - graph.forward.offsets.begin() - 1);
+    }
+};
+
+
+#endif //HOMEWORK_GRAPH_SHORTEST_PATH_TREE_H
@@ -0,0 +1,315 @@
+//
+// Created by juan-diego on 3/29/24.
+//
+
+#ifndef HOMEWORK_GRAPH_SIMD_KERNELS_H
+#define HOMEWORK_GRAPH_SIMD_KERNELS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__i386__) && defined(__SSE2__))
+#define HOMEWORK_GRAPH_SSE 1
+#include <emmintrin.h>
+#endif
+
+#if defined(HOMEWORK_GRAPH_SSE) && (defined(__GNUC__) || defined(__clang__))
+#define HOMEWORK_GRAPH_AVX2 1
+#include <immintrin.h>
+#define HOMEWORK_GRAPH_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+
+// Nivel de instrucciones vectoriales disponible en la maquina actual
+enum SimdLevel {
+    Scalar,
+    SSE,
+    AVX2
+};
+
+
+// *
+// ---- SimdKernels ----
+// Kernels vectorizados para los ciclos aritmeticos mas costosos: la heuristica de A* / Best-First, el
+// vecino mas cercano de la GUI y la relajacion de varias busquedas a la vez ('MultiSourceDijkstra'). Los
+// geometricos trabajan sobre coordenadas en formato SoA ('Graph::xs' y 'Graph::ys'). Todos eligen en tiempo de
+// ejecucion entre AVX2 (8 floats / 4 doubles), SSE (4 floats / 2 doubles) y una version escalar.
+//
+// Funciones miembro
+//     - level         : Nivel SIMD detectado (se calcula una sola vez)
+//     - distances     : out[i] = distancia de (xs[idx[i]], ys[idx[i]]) a (qx, qy), para i en [0, n)
+//     - nearest       : Indice del punto mas cercano a (qx, qy) entre los n primeros
+//     - k_nearest     : Indices de los k puntos mas cercanos a (qx, qy), ordenados por distancia
+//     - relax_lanes   : to[j] = min(to[j], from[j] + length) para j en [0, lanes); devuelve el menor de los
+//                       valores que mejoraron (infinito si ninguno)
+// *
+struct SimdKernels {
+    static SimdLevel level() {
+        static const SimdLevel detected = detect();
+        return detected;
+    }
+
+    static void distances(const float *xs, const float *ys, const std::uint32_t *idx, std::size_t n,
+                          float qx, float qy, float *out) {
+        std::size_t i = 0;
+#ifdef HOMEWORK_GRAPH_AVX2
+        if (level() == AVX2) {
+            i = distances_avx2(xs, ys, idx, n, qx, qy, out);
+        }
+#endif
+#ifdef HOMEWORK_GRAPH_SSE
+        if (level() >= SSE) {
+            __m128 vqx = _mm_set1_ps(qx), vqy = _mm_set1_ps(qy);
+            for (; i + 4 <= n; i += 4) {
+                __m128 x = _mm_set_ps(xs[idx[i + 3]], xs[idx[i + 2]], xs[idx[i + 1]], xs[idx[i]]);
+                __m128 y = _mm_set_ps(ys[idx[i + 3]], ys[idx[i + 2]], ys[idx[i + 1]], ys[idx[i]]);
+                __m128 dx = _mm_sub_ps(x, vqx), dy = _mm_sub_ps(y, vqy);
+                _mm_storeu_ps(out + i, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy))));
+            }
+        }
+#endif
+        for (; i < n; ++i) {
+            float dx = xs[idx[i]] - qx, dy = ys[idx[i]] - qy;
+            out[i] = std::sqrt(dx * dx + dy * dy);
+        }
+    }
+
+    static std::size_t nearest(const float *xs, const float *ys, std::size_t n, float qx, float qy) {
+        std::size_t i = 0;
+        std::size_t best = 0;
+        float best_dist = std::numeric_limits<float>::max();
+#ifdef HOMEWORK_GRAPH_AVX2
+        if (level() == AVX2) {
+            i = nearest_avx2(xs, ys, n, qx, qy, best, best_dist);
+        }
+#endif
+#ifdef HOMEWORK_GRAPH_SSE
+        if (level() == SSE) {
+            i = nearest_sse(xs, ys, n, qx, qy, best, best_dist);
+        }
+#endif
+        for (; i < n; ++i) {
+            float dx = xs[i] - qx, dy = ys[i] - qy;
+            float dist = dx * dx + dy * dy;
+            if (dist < best_dist) {
+                best_dist = dist;
+                best = i;
+            }
+        }
+        return best;
+    }
+
+    static std::vector<std::size_t> k_nearest(const float *xs, const float *ys, std::size_t n,
+                                              float qx, float qy, std::size_t k) {
+        // distancias al cuadrado de todos los puntos, calculadas en bloque
+        std::vector<float> dist(n);
+        std::size_t i = 0;
+#ifdef HOMEWORK_GRAPH_AVX2
+        if (level() == AVX2) {
+            i = squared_distances_avx2(xs, ys, n, qx, qy, dist.data());
+        }
+#endif
+#ifdef HOMEWORK_GRAPH_SSE
+        if (level() >= SSE) {
+            __m128 vqx = _mm_set1_ps(qx), vqy = _mm_set1_ps(qy);
+            for (; i + 4 <= n; i += 4) {
+                __m128 dx = _mm_sub_ps(_mm_loadu_ps(xs + i), vqx);
+                __m128 dy = _mm_sub_ps(_mm_loadu_ps(ys + i), vqy);
+                _mm_storeu_ps(dist.data() + i, _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)));
+            }
+        }
+#endif
+        for (; i < n; ++i) {
+            float dx = xs[i] - qx, dy = ys[i] - qy;
+            dist[i] = dx * dx + dy * dy;
+        }
+
+        std::vector<std::size_t> order(n);
+        std::iota(order.begin(), order.end(), 0);
+        k = std::min(k, n);
+        auto by_dist = [&dist](std::size_t a, std::size_t b) {
+            return dist[a] < dist[b] || (dist[a] == dist[b] && a < b);
+        };
+        std::nth_element(order.begin(), order.begin() + k, order.end(), by_dist);
+        order.resize(k);
+        std::sort(order.begin(), order.end(), by_dist);
+        return order;
+    }
+
+    static double relax_lanes(const double *from, double length, double *to, std::size_t lanes) {
+        std::size_t j = 0;
+        double improved = std::numeric_limits<double>::infinity();
+#ifdef HOMEWORK_GRAPH_AVX2
+        if (level() == AVX2) {
+            j = relax_lanes_avx2(from, length, to, lanes, improved);
+        }
+#endif
+#ifdef HOMEWORK_GRAPH_SSE
+        if (level() == SSE) {
+            __m128d add = _mm_set1_pd(length);
+            __m128d best = _mm_set1_pd(improved);
+            for (; j + 2 <= lanes; j += 2) {
+                __m128d candidate = _mm_add_pd(_mm_loadu_pd(from + j), add);
+                __m128d current = _mm_loadu_pd(to + j);
+                __m128d less = _mm_cmplt_pd(candidate, current);
+                _mm_storeu_pd(to + j, _mm_min_pd(candidate, current));
+                best = _mm_min_pd(best, _mm_or_pd(_mm_and_pd(less, candidate), _mm_andnot_pd(less, best)));
+            }
+            alignas(16) double lane[2];
+            _mm_store_pd(lane, best);
+            improved = std::min(lane[0], lane[1]);
+        }
+#endif
+        for (; j < lanes; ++j) {
+            double candidate = from[j] + length;
+            if (candidate < to[j]) {
+                to[j] = candidate;
+                improved = std::min(improved, candidate);
+            }
+        }
+        return improved;
+    }
+
+private:
+    static SimdLevel detect() {
+#if defined(HOMEWORK_GRAPH_AVX2)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) return AVX2;
+        return SSE;
+#elif defined(HOMEWORK_GRAPH_SSE)
+        return SSE;
+#else
+        return Scalar;
+#endif
+    }
+
+#ifdef HOMEWORK_GRAPH_SSE
+    static std::size_t nearest_sse(const float *xs, const float *ys, std::size_t n, float qx, float qy,
+                                   std::size_t &best, float &best_dist) {
+        if (n < 4) return 0;
+        __m128 vqx = _mm_set1_ps(qx), vqy = _mm_set1_ps(qy);
+        __m128 min_dist = _mm_set1_ps(std::numeric_limits<float>::max());
+        __m128i min_idx = _mm_setzero_si128();
+        __m128i idx = _mm_set_epi32(3, 2, 1, 0);
+        const __m128i step = _mm_set1_epi32(4);
+
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            __m128 dx = _mm_sub_ps(_mm_loadu_ps(xs + i), vqx);
+            __m128 dy = _mm_sub_ps(_mm_loadu_ps(ys + i), vqy);
+            __m128 dist = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+            // SSE2 no tiene blend, se arma con and/andnot/or
+            __m128 less = _mm_cmplt_ps(dist, min_dist);
+            min_dist = _mm_or_ps(_mm_and_ps(less, dist), _mm_andnot_ps(less, min_dist));
+            __m128i less_i = _mm_castps_si128(less);
+            min_idx = _mm_or_si128(_mm_and_si128(less_i, idx), _mm_andnot_si128(less_i, min_idx));
+            idx = _mm_add_epi32(idx, step);
+        }
+
+        alignas(16) float lane_dist[4];
+        alignas(16) std::int32_t lane_idx[4];
+        _mm_store_ps(lane_dist, min_dist);
+        _mm_store_si128(reinterpret_cast<__m128i *>(lane_idx), min_idx);
+        reduce_lanes(lane_dist, lane_idx, 4, best, best_dist);
+        return i;
+    }
+#endif
+
+#ifdef HOMEWORK_GRAPH_AVX2
+    HOMEWORK_GRAPH_TARGET_AVX2
+    static std::size_t distances_avx2(const float *xs, const float *ys, const std::uint32_t *idx, std::size_t n,
+                                      float qx, float qy, float *out) {
+        __m256 vqx = _mm256_set1_ps(qx), vqy = _mm256_set1_ps(qy);
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            __m256i gather = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(idx + i));
+            __m256 dx = _mm256_sub_ps(_mm256_i32gather_ps(xs, gather, 4), vqx);
+            __m256 dy = _mm256_sub_ps(_mm256_i32gather_ps(ys, gather, 4), vqy);
+            __m256 sq = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+            _mm256_storeu_ps(out + i, _mm256_sqrt_ps(sq));
+        }
+        return i;
+    }
+
+    HOMEWORK_GRAPH_TARGET_AVX2
+    static std::size_t squared_distances_avx2(const float *xs, const float *ys, std::size_t n,
+                                              float qx, float qy, float *out) {
+        __m256 vqx = _mm256_set1_ps(qx), vqy = _mm256_set1_ps(qy);
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(xs + i), vqx);
+            __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(ys + i), vqy);
+            _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)));
+        }
+        return i;
+    }
+
+    HOMEWORK_GRAPH_TARGET_AVX2
+    static std::size_t nearest_avx2(const float *xs, const float *ys, std::size_t n, float qx, float qy,
+                                    std::size_t &best, float &best_dist) {
+        if (n < 8) return 0;
+        __m256 vqx = _mm256_set1_ps(qx), vqy = _mm256_set1_ps(qy);
+        __m256 min_dist = _mm256_set1_ps(std::numeric_limits<float>::max());
+        __m256i min_idx = _mm256_setzero_si256();
+        __m256i idx = _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+        const __m256i step = _mm256_set1_epi32(8);
+
+        std::size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(xs + i), vqx);
+            __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(ys + i), vqy);
+            __m256 dist = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+            __m256 less = _mm256_cmp_ps(dist, min_dist, _CMP_LT_OQ);
+            min_dist = _mm256_blendv_ps(min_dist, dist, less);
+            min_idx = _mm256_blendv_epi8(min_idx, idx, _mm256_castps_si256(less));
+            idx = _mm256_add_epi32(idx, step);
+        }
+
+        alignas(32) float lane_dist[8];
+        alignas(32) std::int32_t lane_idx[8];
+        _mm256_store_ps(lane_dist, min_dist);
+        _mm256_store_si256(reinterpret_cast<__m256i *>(lane_idx), min_idx);
+        reduce_lanes(lane_dist, lane_idx, 8, best, best_dist);
+        return i;
+    }
+
+    HOMEWORK_GRAPH_TARGET_AVX2
+    static std::size_t relax_lanes_avx2(const double *from, double length, double *to, std::size_t lanes,
+                                        double &improved) {
+        __m256d add = _mm256_set1_pd(length);
+        __m256d best = _mm256_set1_pd(improved);
+        std::size_t j = 0;
+        for (; j + 4 <= lanes; j += 4) {
+            __m256d candidate = _mm256_add_pd(_mm256_loadu_pd(from + j), add);
+            __m256d current = _mm256_loadu_pd(to + j);
+            __m256d less = _mm256_cmp_pd(candidate, current, _CMP_LT_OQ);
+            _mm256_storeu_pd(to + j, _mm256_blendv_pd(current, candidate, less));
+            best = _mm256_min_pd(best, _mm256_blendv_pd(best, candidate, less));
+        }
+
+        alignas(32) double lane[4];
+        _mm256_store_pd(lane, best);
+        improved = std::min(std::min(lane[0], lane[1]), std::min(lane[2], lane[3]));
+        return j;
+    }
+#endif
+
+    // Combina los minimos de cada carril; en empates gana el indice menor, igual que la version escalar
+    static void reduce_lanes(const float *lane_dist, const std::int32_t *lane_idx, int lanes,
+                             std::size_t &best, float &best_dist) {
+        for (int lane = 0; lane < lanes; ++lane) {
+            auto index = static_cast<std::size_t>(lane_idx[lane]);
+            if (lane_dist[lane] < best_dist || (lane_dist[lane] == best_dist && index < best)) {
+                best_dist = lane_dist[lane];
+                best = index;
+            }
+        }
+    }
+};
+
+
+#endif //HOMEWORK_GRAPH_SIMD_KERNELS_H
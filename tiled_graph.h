@@ -0,0 +1,738 @@
+//
+// Created by juan-diego on 3/29/24.
+//
+
+#ifndef HOMEWORK_GRAPH_TILED_GRAPH_H
+#define HOMEWORK_GRAPH_TILED_GRAPH_H
+
+#include "graph.h"
+#include "search_budget.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <list>
+#include <memory>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+// Un nodo del grafo por teselas: tesela y posicion dentro de ella
+struct TileNodeRef {
+    std::uint32_t tile = 0;
+    std::uint32_t node = 0;
+
+    std::uint64_t key() const {
+        return static_cast<std::uint64_t>(tile) << 32 | node;
+    }
+
+    static TileNodeRef from_key(std::uint64_t key) {
+        return {static_cast<std::uint32_t>(key >> 32), static_cast<std::uint32_t>(key)};
+    }
+};
+
+
+// Nodo guardado en una tesela: id de OSM y coordenada
+struct TileNode {
+    std::uint64_t id;
+    sf::Vector2f coord;
+};
+
+
+// *
+// ---- TileArc ----
+// Arco que sale de un nodo de la tesela. El otro extremo puede estar en otra tesela (arco de frontera); se
+// guarda como 'TileNodeRef', asi que recorrerlo no necesita ninguna tabla global, y con su coordenada, asi que
+// la heuristica de A* no obliga a cargar la otra tesela hasta que la busqueda procese ese nodo.
+//
+// Variables miembro
+//     - tile, node    : Otro extremo del arco
+//     - length        : Costo del arco ('Edge::length')
+//     - to            : Coordenada del otro extremo
+//     - polyline      : Trayectoria de la arista dentro de 'Tile::points' (ver 'Tile::polyline')
+//     - reversed      : 1 si el arco recorre la arista de 'dest' a 'src'
+// *
+struct TileArc {
+    std::uint32_t tile;
+    std::uint32_t node;
+    double length;
+    sf::Vector2f to;
+    std::uint32_t polyline;
+    std::uint32_t reversed;
+};
+
+
+// *
+// ---- Tile ----
+// Una celda de la grilla de 'TiledGraph' ya cargada en memoria: sus nodos (en orden de 'Node::index'), la
+// adyacencia CSR de esos nodos y la trayectoria de cada arista que toca la tesela. Cada arista se dibuja en la
+// tesela de su 'src' ('owned'); si es de doble sentido tambien aparece, sin dibujarse, en la de su 'dest' para
+// que el arco inverso tenga su trayectoria. 'geometry' son los cuadrilateros de las aristas propias, armados
+// al cargar, asi que dibujar la tesela es una sola llamada a draw.
+//
+// Funciones miembro
+//     - begin / end   : Rango de arcos del nodo u
+//     - polyline      : Puntos de la trayectoria de un arco, en el sentido en que se recorre
+//     - memory_bytes  : Memoria de la tesela (incluye 'geometry')
+// *
+struct Tile {
+    std::vector<TileNode> nodes;
+    std::vector<std::uint32_t> offsets;
+    std::vector<TileArc> arcs;
+    std::vector<std::uint32_t> polyline_offsets;  // puntos de la trayectoria i: [offsets[i], offsets[i + 1])
+    std::vector<std::uint8_t> owned;
+    std::vector<sf::Vector2f> points;
+    sf::VertexArray geometry {sf::Quads};
+
+    const TileArc *begin(std::uint32_t u) const {
+        return arcs.data() + offsets[u];
+    }
+
+    const TileArc *end(std::uint32_t u) const {
+        return arcs.data() + offsets[u + 1];
+    }
+
+    std::vector<sf::Vector2f> polyline(const TileArc &arc) const {
+        std::vector<sf::Vector2f> line(points.begin() + polyline_offsets[arc.polyline],
+                                       points.begin() + polyline_offsets[arc.polyline + 1]);
+        if (arc.reversed) std::reverse(line.begin(), line.end());
+        return line;
+    }
+
+    std::size_t memory_bytes() const {
+        return nodes.size() * sizeof(TileNode) + offsets.size() * sizeof(std::uint32_t) +
+               arcs.size() * sizeof(TileArc) + polyline_offsets.size() * sizeof(std::uint32_t) + owned.size() +
+               points.size() * sizeof(sf::Vector2f) + geometry.getVertexCount() * sizeof(sf::Vertex);
+    }
+};
+
+
+// Contadores del cache de teselas de 'TiledGraph'
+struct TileCacheStats {
+    std::size_t loads = 0;      // Teselas leidas del archivo
+    std::size_t evictions = 0;  // Teselas descartadas por superar 'max_resident'
+    std::size_t hits = 0;       // Pedidos de una tesela que ya estaba en memoria
+};
+
+
+// *
+// ---- TiledGraph ----
+// Grafo guardado en disco particionado por una grilla geografica de 'grid' x 'grid' celdas (teselas). Al abrir
+// el archivo solo se leen el encabezado y el directorio de teselas; cada tesela se lee la primera vez que se
+// pide (la GUI por teselas pide las que ve, la busqueda las que alcanza su frontera) y se mantiene en un cache
+// LRU de a lo mas 'max_resident' teselas. Arrancar no depende del tamaño del grafo y la memoria queda acotada.
+//
+// Los arcos que cruzan de una tesela a otra apuntan directamente al nodo de la otra tesela ('TileArc'), asi
+// que una busqueda nunca necesita una tabla de todos los nodos. Para ubicar un id de OSM hay un directorio
+// ordenado por id al final del archivo que 'locate' recorre con busqueda binaria sobre el disco.
+//
+// Un 'Tile&' devuelto por 'tile' sigue siendo valido hasta el siguiente pedido de otra tesela (que puede
+// descartarlo); quien necesite datos de dos teselas a la vez debe copiarlos antes.
+//
+// Variables miembro
+//     - max_resident  : Teselas que se mantienen en memoria a la vez (minimo 2)
+//     - stats         : Cargas, descartes y aciertos del cache
+//
+// Funciones miembro
+//     - build         : Escribe el archivo de teselas de un grafo ya cargado
+//     - open          : Abre un archivo de teselas (solo lee el encabezado y el directorio)
+//     - tile          : Tesela 't', leyendola del disco si no esta en memoria
+//     - tile_at       : Tesela que contiene un punto
+//     - tiles_in      : Teselas que intersectan un rectangulo
+//     - locate        : Ubica el nodo con un id de OSM
+//     - nearest       : Nodo mas cercano a un punto, buscando en la tesela del punto y en anillos alrededor
+// *
+class TiledGraph {
+    std::ifstream file;
+    std::uint32_t grid = 0;
+    std::uint64_t node_count = 0;
+    float min_x = 0.0f, min_y = 0.0f, cell_width = 1.0f, cell_height = 1.0f;
+    double scale = 1.0;
+    std::uint64_t ids_offset = 0;
+
+    // 'offset' y 'bytes' del bloque de cada tesela en el archivo
+    struct DirectoryEntry {
+        std::uint64_t offset;
+        std::uint32_t bytes;
+        std::uint32_t nodes;
+    };
+    std::vector<DirectoryEntry> directory;
+
+    // entrada del directorio de ids (ordenado por 'id')
+    struct IdEntry {
+        std::uint64_t id;
+        std::uint32_t tile;
+        std::uint32_t node;
+    };
+
+    std::vector<std::unique_ptr<Tile>> resident;
+    std::list<std::uint32_t> lru;  // mas reciente al frente
+    std::vector<std::list<std::uint32_t>::iterator> lru_position;
+
+    static constexpr char magic[4] = {'T', 'I', 'L', 'E'};
+    static constexpr std::uint32_t version = 1;
+
+public:
+    std::size_t max_resident = 64;
+    TileCacheStats stats;
+
+    //* --- build ---
+    // Formato (enteros en el orden de bytes de la maquina):
+    //     "TILE" | version | grid | nodos | min_x | min_y | ancho y alto de celda | heuristic_scale |
+    //     offset del directorio de ids | (offset, bytes, nodos)[grid * grid] | teselas | IdEntry[nodos]
+    // y cada tesela es
+    //     nodos | arcos | trayectorias | puntos | TileNode[] | offsets[nodos + 1] | TileArc[] |
+    //     polyline_offsets[trayectorias + 1] | owned[] | puntos[]
+    //*
+    static bool build(const Graph &graph, const std::string &path, std::uint32_t grid = 16) {
+        std::ofstream out(path, std::ios::binary);
+        if (!out || graph.node_storage.empty()) return false;
+        grid = std::max(1u, grid);
+
+        auto [low_x, high_x] = std::minmax_element(graph.xs.begin(), graph.xs.end());
+        auto [low_y, high_y] = std::minmax_element(graph.ys.begin(), graph.ys.end());
+        float x0 = *low_x, y0 = *low_y;
+        // la celda se agranda un poco para que el maximo caiga dentro de la ultima
+        float width = std::max((*high_x - x0) / static_cast<float>(grid), 1e-3f) * 1.0001f;
+        float height = std::max((*high_y - y0) / static_cast<float>(grid), 1e-3f) * 1.0001f;
+
+        std::size_t n = graph.node_storage.size();
+        std::vector<std::uint32_t> tile_of(n), local(n);
+        std::vector<std::vector<std::uint32_t>> members(static_cast<std::size_t>(grid) * grid);
+        for (std::uint32_t v = 0; v < n; ++v) {
+            tile_of[v] = cell(graph.xs[v], graph.ys[v], x0, y0, width, height, grid);
+            local[v] = static_cast<std::uint32_t>(members[tile_of[v]].size());
+            members[tile_of[v]].push_back(v);
+        }
+
+        auto count = static_cast<std::uint64_t>(n);
+        std::uint64_t ids_at = 0;
+        out.write(magic, sizeof(magic));
+        write(out, version);
+        write(out, grid);
+        write(out, count);
+        write(out, x0);
+        write(out, y0);
+        write(out, width);
+        write(out, height);
+        write(out, graph.heuristic_scale);
+        std::streampos ids_slot = out.tellp();
+        write(out, ids_at);
+        std::streampos directory_slot = out.tellp();
+        std::vector<DirectoryEntry> entries(members.size(), DirectoryEntry {0, 0, 0});
+        write_vector(out, entries);
+
+        for (std::size_t t = 0; t < members.size(); ++t) {
+            std::vector<TileNode> nodes;
+            std::vector<std::uint32_t> offsets {0};
+            std::vector<TileArc> arcs;
+            std::vector<std::uint32_t> polyline_offsets {0};
+            std::vector<std::uint8_t> owned;
+            std::vector<sf::Vector2f> points;
+            std::unordered_map<std::size_t, std::uint32_t> polyline_of;  // 'Edge::index' -> trayectoria
+
+            auto polyline = [&](const Edge *edge) {
+                auto [it, inserted] = polyline_of.insert({edge->index, static_cast<std::uint32_t>(owned.size())});
+                if (inserted) {
+                    std::vector<sf::Vector2f> line = edge->points_from(edge->src);
+                    points.insert(points.end(), line.begin(), line.end());
+                    polyline_offsets.push_back(static_cast<std::uint32_t>(points.size()));
+                    owned.push_back(tile_of[edge->src->index] == t);
+                }
+                return it->second;
+            };
+
+            for (std::uint32_t v: members[t]) {
+                const Node &node = graph.node_storage[v];
+                nodes.push_back({node.id, node.coord});
+                for (const Arc *arc = graph.forward.begin(v); arc != graph.forward.end(v); ++arc) {
+                    const Edge *edge = graph.edges[arc->edge];
+                    std::uint32_t reversed = edge->src->index != v;
+                    arcs.push_back({tile_of[arc->to], local[arc->to], arc->length, graph.node_storage[arc->to].coord,
+                                    polyline(edge), reversed});
+                }
+                offsets.push_back(static_cast<std::uint32_t>(arcs.size()));
+            }
+
+            entries[t].offset = static_cast<std::uint64_t>(out.tellp());
+            entries[t].nodes = static_cast<std::uint32_t>(nodes.size());
+            write(out, static_cast<std::uint32_t>(nodes.size()));
+            write(out, static_cast<std::uint32_t>(arcs.size()));
+            write(out, static_cast<std::uint32_t>(owned.size()));
+            write(out, static_cast<std::uint32_t>(points.size()));
+            write_vector(out, nodes);
+            write_vector(out, offsets);
+            write_vector(out, arcs);
+            write_vector(out, polyline_offsets);
+            write_vector(out, owned);
+            write_vector(out, points);
+            entries[t].bytes = static_cast<std::uint32_t>(static_cast<std::uint64_t>(out.tellp()) - entries[t].offset);
+        }
+
+        std::vector<IdEntry> ids;
+        ids.reserve(n);
+        for (std::uint32_t v = 0; v < n; ++v) ids.push_back({graph.node_storage[v].id, tile_of[v], local[v]});
+        std::sort(ids.begin(), ids.end(), [](const IdEntry &a, const IdEntry &b) { return a.id < b.id; });
+        ids_at = static_cast<std::uint64_t>(out.tellp());
+        write_vector(out, ids);
+
+        out.seekp(ids_slot);
+        write(out, ids_at);
+        out.seekp(directory_slot);
+        write_vector(out, entries);
+        return static_cast<bool>(out);
+    }
+
+    bool open(const std::string &path, std::size_t max_tiles = 64) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) return false;
+
+        char header[4];
+        std::uint32_t file_version = 0, file_grid = 0;
+        in.read(header, sizeof(header));
+        read(in, file_version);
+        read(in, file_grid);
+        read(in, node_count);
+        read(in, min_x);
+        read(in, min_y);
+        read(in, cell_width);
+        read(in, cell_height);
+        read(in, scale);
+        read(in, ids_offset);
+        if (!in || std::memcmp(header, magic, sizeof(magic)) != 0 || file_version != version || file_grid == 0) {
+            return false;
+        }
+        // el directorio y cada bloque que nombra tienen que caber en el archivo
+        std::streampos directory_start = in.tellg();
+        in.seekg(0, std::ios::end);
+        auto size = static_cast<std::uint64_t>(in.tellg());
+        in.seekg(directory_start);
+        std::vector<DirectoryEntry> entries;
+        if (!read_vector(in, entries, static_cast<std::size_t>(file_grid) * file_grid)) return false;
+        for (const DirectoryEntry &entry: entries) {
+            if (entry.offset > size || entry.bytes > size - entry.offset) return false;
+        }
+        if (ids_offset > size || node_count > (size - ids_offset) / sizeof(IdEntry)) return false;
+        grid = file_grid;
+        directory = std::move(entries);
+
+        file = std::move(in);
+        max_resident = std::max<std::size_t>(2, max_tiles);
+        resident.clear();
+        resident.resize(directory.size());
+        lru.clear();
+        lru_position.assign(directory.size(), lru.end());
+        stats = TileCacheStats();
+        return true;
+    }
+
+    bool is_open() const {
+        return !directory.empty();
+    }
+
+    //* --- tile ---
+    // Devuelve la tesela 't' y la marca como la mas reciente. Si no estaba en memoria la lee del disco y, si
+    // con ella se supera 'max_resident', descarta la usada hace mas tiempo.
+    //*
+    const Tile &tile(std::uint32_t t) {
+        if (resident[t]) {
+            stats.hits++;
+            lru.splice(lru.begin(), lru, lru_position[t]);
+            return *resident[t];
+        }
+
+        while (lru.size() >= max_resident) {
+            std::uint32_t victim = lru.back();
+            lru.pop_back();
+            resident[victim].reset();
+            lru_position[victim] = lru.end();
+            stats.evictions++;
+        }
+
+        resident[t] = load(t);
+        lru.push_front(t);
+        lru_position[t] = lru.begin();
+        stats.loads++;
+        return *resident[t];
+    }
+
+    std::uint32_t tile_at(sf::Vector2f point) const {
+        return cell(point.x, point.y, min_x, min_y, cell_width, cell_height, grid);
+    }
+
+    std::vector<std::uint32_t> tiles_in(const sf::FloatRect &area) const {
+        std::uint32_t first_col, first_row, last_col, last_row;
+        column_row(tile_at({area.left, area.top}), first_col, first_row);
+        column_row(tile_at({area.left + area.width, area.top + area.height}), last_col, last_row);
+
+        std::vector<std::uint32_t> tiles;
+        for (std::uint32_t row = first_row; row <= last_row; ++row) {
+            for (std::uint32_t col = first_col; col <= last_col; ++col) {
+                std::uint32_t t = row * grid + col;
+                if (directory[t].nodes > 0) tiles.push_back(t);
+            }
+        }
+        return tiles;
+    }
+
+    //* --- locate ---
+    // Busqueda binaria sobre el directorio de ids del archivo: log2(nodos) lecturas de 16 bytes, sin tener los
+    // ids en memoria.
+    //*
+    bool locate(std::uint64_t id, TileNodeRef &ref) {
+        std::uint64_t low = 0, high = node_count;
+        while (low < high) {
+            std::uint64_t middle = low + (high - low) / 2;
+            IdEntry entry {};
+            file.clear();
+            file.seekg(static_cast<std::streamoff>(ids_offset + middle * sizeof(IdEntry)));
+            read(file, entry);
+            if (!file) return false;
+            if (entry.id == id) {
+                if (entry.tile >= directory.size() || entry.node >= directory[entry.tile].nodes) return false;
+                ref = {entry.tile, entry.node};
+                return true;
+            }
+            if (entry.id < id) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        return false;
+    }
+
+    //* --- nearest ---
+    // Revisa la tesela del punto y luego anillos de teselas cada vez mas alejados. Se detiene cuando el anillo
+    // siguiente ya esta mas lejos que el mejor nodo encontrado.
+    //*
+    bool nearest(sf::Vector2f point, TileNodeRef &ref) {
+        std::uint32_t col, row;
+        column_row(tile_at(point), col, row);
+        float best = std::numeric_limits<float>::max();
+        bool found = false;
+
+        for (std::uint32_t ring = 0; ring < grid; ++ring) {
+            // distancia minima de 'point' a cualquier celda del anillo
+            float reach = (static_cast<float>(ring) - 1.0f) * std::min(cell_width, cell_height);
+            if (found && reach > 0.0f && reach * reach > best) break;
+
+            for (std::int64_t r = std::int64_t(row) - ring; r <= std::int64_t(row) + ring; ++r) {
+                for (std::int64_t c = std::int64_t(col) - ring; c <= std::int64_t(col) + ring; ++c) {
+                    bool border = r == std::int64_t(row) - ring || r == std::int64_t(row) + ring ||
+                                  c == std::int64_t(col) - ring || c == std::int64_t(col) + ring;
+                    if (!border || r < 0 || c < 0 || r >= grid || c >= grid) continue;
+                    auto t = static_cast<std::uint32_t>(r * grid + c);
+                    if (directory[t].nodes == 0) continue;
+
+                    const Tile &candidate = tile(t);
+                    for (std::uint32_t v = 0; v < candidate.nodes.size(); ++v) {
+                        sf::Vector2f delta = candidate.nodes[v].coord - point;
+                        float distance = delta.x * delta.x + delta.y * delta.y;
+                        if (distance < best) {
+                            best = distance;
+                            ref = {t, v};
+                            found = true;
+                        }
+                    }
+                }
+            }
+        }
+        return found;
+    }
+
+    const TileNode &node(TileNodeRef ref) {
+        return tile(ref.tile).nodes[ref.node];
+    }
+
+    double heuristic_scale() const {
+        return scale;
+    }
+
+    std::size_t resident_count() const {
+        return lru.size();
+    }
+
+    std::size_t resident_bytes() const {
+        std::size_t bytes = 0;
+        for (std::uint32_t t: lru) bytes += resident[t]->memory_bytes();
+        return bytes;
+    }
+
+    std::size_t tile_count() const {
+        return directory.size();
+    }
+
+    std::size_t size() const {
+        return node_count;
+    }
+
+    // Rectangulo que cubre todas las teselas
+    sf::FloatRect bounds() const {
+        return {min_x, min_y, cell_width * static_cast<float>(grid), cell_height * static_cast<float>(grid)};
+    }
+
+private:
+    static std::uint32_t cell(float x, float y, float x0, float y0, float width, float height, std::uint32_t grid) {
+        auto clamp = [grid](float value) {
+            if (!(value > 0.0f)) return 0u;
+            return std::min(grid - 1, static_cast<std::uint32_t>(value));
+        };
+        return clamp((y - y0) / height) * grid + clamp((x - x0) / width);
+    }
+
+    void column_row(std::uint32_t t, std::uint32_t &col, std::uint32_t &row) const {
+        col = t % grid;
+        row = t / grid;
+    }
+
+    std::unique_ptr<Tile> load(std::uint32_t t) {
+        auto loaded = std::make_unique<Tile>();
+        file.clear();
+        file.seekg(static_cast<std::streamoff>(directory[t].offset));
+
+        std::uint32_t nodes = 0, arcs = 0, polylines = 0, points = 0;
+        read(file, nodes);
+        read(file, arcs);
+        read(file, polylines);
+        read(file, points);
+        // las cantidades vienen del archivo: antes de reservar memoria tienen que sumar el tamaño del bloque
+        std::uint64_t expected = 4 * sizeof(std::uint32_t) + std::uint64_t(nodes) * sizeof(TileNode) +
+                                 (std::uint64_t(nodes) + 1) * sizeof(std::uint32_t) + std::uint64_t(arcs) * sizeof(TileArc) +
+                                 (std::uint64_t(polylines) + 1) * sizeof(std::uint32_t) + polylines +
+                                 std::uint64_t(points) * sizeof(sf::Vector2f);
+        bool ok = static_cast<bool>(file) && nodes == directory[t].nodes && expected == directory[t].bytes &&
+                  read_vector(file, loaded->nodes, nodes) && read_vector(file, loaded->offsets, nodes + 1) &&
+                  read_vector(file, loaded->arcs, arcs) &&
+                  read_vector(file, loaded->polyline_offsets, polylines + 1) &&
+                  read_vector(file, loaded->owned, polylines) && read_vector(file, loaded->points, points) &&
+                  valid(*loaded);
+        if (!ok) {
+            // archivo truncado o corrupto: la tesela queda vacia en lugar de tener indices invalidos
+            std::cerr << "No se pudo leer la tesela " << t << std::endl;
+            loaded = std::make_unique<Tile>();
+            loaded->offsets.assign(1, 0);
+            return loaded;
+        }
+
+        for (std::uint32_t i = 0; i < polylines; ++i) {
+            if (!loaded->owned[i]) continue;
+            for (std::uint32_t p = loaded->polyline_offsets[i] + 1; p < loaded->polyline_offsets[i + 1]; ++p) {
+                append_line(loaded->geometry, loaded->points[p - 1], loaded->points[p]);
+            }
+        }
+        return loaded;
+    }
+
+    // offsets[0] == 0, no decrecientes y terminando en 'last'
+    static bool valid_offsets(const std::vector<std::uint32_t> &offsets, std::size_t last) {
+        return offsets.front() == 0 && offsets.back() == last && std::is_sorted(offsets.begin(), offsets.end());
+    }
+
+    // Revisa los indices que usan 'TiledSearch' y la GUI antes de que la tesela entre al cache: los CSR, el
+    // otro extremo de cada arco (tesela y nodo, segun el directorio) y su trayectoria (al menos dos puntos)
+    bool valid(const Tile &loaded) const {
+        if (!valid_offsets(loaded.offsets, loaded.arcs.size()) ||
+            !valid_offsets(loaded.polyline_offsets, loaded.points.size())) {
+            return false;
+        }
+        std::size_t polylines = loaded.owned.size();
+        for (const TileArc &arc: loaded.arcs) {
+            if (arc.tile >= directory.size() || arc.node >= directory[arc.tile].nodes || arc.polyline >= polylines ||
+                loaded.polyline_offsets[arc.polyline + 1] - loaded.polyline_offsets[arc.polyline] < 2 ||
+                !(arc.length >= 0.0)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // mismo rectangulo que 'sfLine', con el color y grosor por defecto de 'Edge'
+    static void append_line(sf::VertexArray &geometry, sf::Vector2f p1, sf::Vector2f p2) {
+        sf::Vector2f direction = p2 - p1;
+        float length = std::sqrt(direction.x * direction.x + direction.y * direction.y);
+        if (length == 0.0f) return;
+        sf::Vector2f offset = (default_thickness / 2.f / length) * sf::Vector2f(-direction.y, direction.x);
+
+        geometry.append(sf::Vertex(p1 + offset, default_edge_color));
+        geometry.append(sf::Vertex(p2 + offset, default_edge_color));
+        geometry.append(sf::Vertex(p2 - offset, default_edge_color));
+        geometry.append(sf::Vertex(p1 - offset, default_edge_color));
+    }
+
+    template<typename T>
+    static void write(std::ofstream &out, const T &value) {
+        out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    template<typename T>
+    static void read(std::ifstream &in, T &value) {
+        in.read(reinterpret_cast<char *>(&value), sizeof(T));
+    }
+
+    template<typename T>
+    static void write_vector(std::ofstream &out, const std::vector<T> &values) {
+        out.write(reinterpret_cast<const char *>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(T)));
+    }
+
+    template<typename T>
+    static bool read_vector(std::ifstream &in, std::vector<T> &values, std::size_t count) {
+        std::streampos start = in.tellg();
+        in.seekg(0, std::ios::end);
+        std::streamoff remaining = in.tellg() - start;
+        in.seekg(start);
+        if (!in || remaining < 0 || count > static_cast<std::uint64_t>(remaining) / sizeof(T)) {
+            return false;
+        }
+        values.resize(count);
+        in.read(reinterpret_cast<char *>(values.data()), static_cast<std::streamsize>(count * sizeof(T)));
+        return static_cast<bool>(in);
+    }
+};
+
+
+// *
+// ---- TiledRoute ----
+// Resultado de 'TiledSearch::run'.
+//
+// Variables miembro
+//     - status        : Found, Unreachable o el limite que detuvo la busqueda
+//     - cost          : Costo del camino (si se encontro)
+//     - path          : Ids de OSM de los nodos del camino, de 'src' a 'dest'
+//     - points        : Trayectoria del camino (con los puntos intermedios de cada arista), para dibujarla
+//     - settled       : Nodos procesados
+//     - memory_bytes  : Memoria estimada de las etiquetas y la cola al terminar (sin las teselas)
+//     - tiles_loaded  : Teselas leidas del disco durante la busqueda
+// *
+struct TiledRoute {
+    SearchStatus status = NotRun;
+    double cost = 0.0;
+    std::vector<std::uint64_t> path;
+    std::vector<sf::Vector2f> points;
+    std::size_t settled = 0;
+    std::size_t memory_bytes = 0;
+    std::size_t tiles_loaded = 0;
+};
+
+
+// *
+// ---- TiledSearch ----
+// A* sobre un 'TiledGraph' con la heuristica en linea recta escalada por 'heuristic_scale' (con
+// 'use_heuristic' falso es Dijkstra). Las etiquetas se guardan en una tabla hash por 'TileNodeRef::key', asi
+// que la memoria depende de lo explorado y no del tamaño del grafo; esa tabla y la cola cuentan para
+// 'SearchBudget::max_memory' (las teselas ya estan acotadas por 'TiledGraph::max_resident'). La tesela de un
+// vecino se carga cuando la busqueda procesa el primer nodo de ella.
+//
+// Funciones miembro
+//     - run           : Busqueda de 'src' a 'dest' con los limites de 'budget' y 'token'. 'progress' se llama
+//                       cada 'progress_interval' nodos procesados, para que quien la lanzo atienda sus eventos
+//                       (la GUI por teselas cancela 'token' con Escape)
+// *
+struct TiledSearch {
+    static constexpr std::size_t progress_interval = 1000;
+
+    static TiledRoute run(TiledGraph &graph, TileNodeRef src, TileNodeRef dest, bool use_heuristic = true,
+                          const SearchBudget &budget = SearchBudget(), const CancellationToken *token = nullptr,
+                          const std::function<void()> &progress = nullptr) {
+        struct Label {
+            double g;
+            std::uint64_t parent;
+            std::uint32_t parent_arc;  // posicion del arco en los arcos de la tesela de 'parent'
+            bool closed;
+        };
+        typedef std::pair<double, std::uint64_t> Entry;
+
+        TiledRoute route;
+        std::size_t loads_before = graph.stats.loads;
+        BudgetGuard guard(budget, token);
+
+        sf::Vector2f target = graph.node(dest).coord;
+        double scale = use_heuristic ? graph.heuristic_scale() : 0.0;
+        auto h = [&](sf::Vector2f coord) {
+            sf::Vector2f delta = target - coord;
+            return scale * std::sqrt(static_cast<double>(delta.x) * delta.x + static_cast<double>(delta.y) * delta.y);
+        };
+
+        std::unordered_map<std::uint64_t, Label> labels;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> pq;
+        // cada etiqueta es un nodo de la tabla (valor, puntero al siguiente y hash guardado) mas su cubeta
+        auto memory = [&]() {
+            return labels.size() * (sizeof(std::pair<const std::uint64_t, Label>) + 2 * sizeof(void *)) +
+                   labels.bucket_count() * sizeof(void *) + pq.size() * sizeof(Entry);
+        };
+        labels[src.key()] = {0.0, src.key(), 0, false};
+        pq.push({h(graph.node(src).coord), src.key()});
+
+        std::vector<TileArc> arcs;
+        route.status = Unreachable;
+        while (!pq.empty()) {
+            std::uint64_t key = pq.top().second;
+            pq.pop();
+            Label &label = labels[key];
+            if (label.closed) continue;
+            label.closed = true;
+            route.settled++;
+            double g = label.g;
+
+            if (key == dest.key()) {
+                route.status = Found;
+                break;
+            }
+            if (progress && route.settled % progress_interval == 0) {
+                progress();
+            }
+            SearchStatus stop = guard.check(route.settled, memory());
+            if (stop != NotRun) {
+                route.status = stop;
+                break;
+            }
+
+            // se copian los arcos porque cargar la tesela de un vecino puede descartar la de 'key'
+            TileNodeRef u = TileNodeRef::from_key(key);
+            const Tile &tile = graph.tile(u.tile);
+            auto first = static_cast<std::uint32_t>(tile.begin(u.node) - tile.arcs.data());
+            arcs.assign(tile.begin(u.node), tile.end(u.node));
+
+            for (std::uint32_t i = 0; i < arcs.size(); ++i) {
+                const TileArc &arc = arcs[i];
+                TileNodeRef v {arc.tile, arc.node};
+                double candidate = g + arc.length;
+                auto [it, inserted] = labels.insert({v.key(), {candidate, key, first + i, false}});
+                if (!inserted) {
+                    if (it->second.closed || candidate >= it->second.g) continue;
+                    it->second = {candidate, key, first + i, false};
+                }
+                pq.push({candidate + h(arc.to), v.key()});
+            }
+        }
+
+        route.memory_bytes = memory();
+
+        if (route.status == Found) {
+            route.cost = labels[dest.key()].g;
+            std::vector<std::uint64_t> keys;
+            for (std::uint64_t key = dest.key(); key != src.key(); key = labels[key].parent) keys.push_back(key);
+            keys.push_back(src.key());
+            std::reverse(keys.begin(), keys.end());
+
+            for (std::size_t i = 0; i < keys.size(); ++i) {
+                route.path.push_back(graph.node(TileNodeRef::from_key(keys[i])).id);
+                if (i == 0) continue;
+                const Label &step = labels[keys[i]];
+                const Tile &tile = graph.tile(TileNodeRef::from_key(step.parent).tile);
+                std::vector<sf::Vector2f> line = tile.polyline(tile.arcs[step.parent_arc]);
+                route.points.insert(route.points.end(), line.begin() + (route.points.empty() ? 0 : 1), line.end());
+            }
+        }
+        route.tiles_loaded = graph.stats.loads - loads_before;
+        return route;
+    }
+};
+
+
+#endif //HOMEWORK_GRAPH_TILED_GRAPH_H
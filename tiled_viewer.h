@@ -0,0 +1,255 @@
+//
+// Created by juan-diego on 3/29/24.
+//
+
+#ifndef HOMEWORK_GRAPH_TILED_VIEWER_H
+#define HOMEWORK_GRAPH_TILED_VIEWER_H
+
+
+#include "window_manager.h"
+#include "tiled_graph.h"
+
+#include <chrono>
+#include <iostream>
+
+
+// *
+// ---- TiledViewer ----
+// Variante de 'GUI' sobre un archivo de teselas ('tiled_graph.h'): no carga el grafo al arrancar, solo las
+// teselas que entran en la vista, y las busquedas cargan las que alcanza su frontera. La vista se mueve con las
+// flechas y se acerca o aleja con la rueda del mouse (o + / -); no se puede alejar mas alla de lo que cabe en
+// 'TiledGraph::max_resident' teselas, asi dibujar un frame nunca descarta una tesela del mismo frame.
+//
+// Teclas: D = Dijkstra, A = A*, Escape = abortar la busqueda en curso, R = limpiar, I = estado del cache de
+// teselas, Q = salir. Los clicks eligen 'src' y luego 'dest' (nodo mas cercano, ver 'TiledGraph::nearest').
+// *
+class TiledViewer {
+    WindowManager window_manager;
+    TiledGraph graph;
+    sf::View view;
+
+    bool has_src = false, has_dest = false;
+    TileNodeRef src, dest;
+    sf::Vector2f src_coord, dest_coord;
+    TiledRoute route;
+    sf::VertexArray route_geometry {sf::Quads};
+
+    // Limites de cada busqueda (por defecto sin limite) y la bandera que se activa con Escape
+    SearchBudget search_budget;
+    CancellationToken cancellation;
+
+    void run(bool use_heuristic) {
+        if (!has_src || !has_dest) {
+            std::cout << "Se necesita un origen y un destino" << std::endl;
+            return;
+        }
+        auto started = std::chrono::steady_clock::now();
+        cancellation.reset();
+        route = TiledSearch::run(graph, src, dest, use_heuristic, search_budget, &cancellation,
+                                 [this]() { poll_cancel(); });
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+        std::cout << to_string(route.status) << ": costo " << route.cost << ", " << route.settled
+                  << " nodos procesados, " << route.memory_bytes / 1024 << " KiB, " << route.tiles_loaded
+                  << " teselas leidas, " << ms << " ms" << std::endl;
+
+        route_geometry.clear();
+        for (std::size_t i = 1; i < route.points.size(); ++i) {
+            append_line(route.points[i - 1], route.points[i], sf::Color::Yellow, 3.0f);
+        }
+    }
+
+    // Mientras corre la busqueda 'main_loop' no atiende eventos (igual que en 'PathFindingManager::render'): aqui
+    // se revisa si se pidio abortar (Escape) o se cerro la ventana. No se dibuja, asi la busqueda no compite con
+    // el dibujado por las teselas del cache. El resto de eventos se descarta.
+    void poll_cancel() {
+        sf::Event event{};
+        while (window_manager.poll_event(event)) {
+            bool closed = event.type == sf::Event::Closed;
+            bool escape = event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::Escape;
+            if (closed || escape) {
+                cancellation.cancel();
+            }
+            if (closed) {
+                window_manager.close();
+            }
+        }
+    }
+
+    void reset() {
+        has_src = has_dest = false;
+        route = TiledRoute();
+        route_geometry.clear();
+    }
+
+    void select(sf::Vector2f point) {
+        TileNodeRef ref;
+        if (!graph.nearest(point, ref)) return;
+        const TileNode &node = graph.node(ref);
+        if (!has_src) {
+            src = ref;
+            src_coord = node.coord;
+            has_src = true;
+            std::cout << "Source node seleccionado: " << node.id << std::endl;
+        } else if (!has_dest) {
+            dest = ref;
+            dest_coord = node.coord;
+            has_dest = true;
+            std::cout << "Destination node seleccionado: " << node.id << std::endl;
+        }
+    }
+
+    sf::FloatRect visible_area() const {
+        sf::Vector2f size = view.getSize();
+        sf::Vector2f corner = view.getCenter() - size / 2.0f;
+        return {corner.x, corner.y, size.x, size.y};
+    }
+
+    // Acerca la vista hasta que las teselas visibles entren en 'max_resident'. No alcanza con revisarlo al
+    // alejar: al mover la vista puede dejar de estar recortada por el borde del mapa o cruzar una fila o columna
+    // mas de la grilla
+    void fit_view() {
+        while (graph.tiles_in(visible_area()).size() > graph.max_resident && view.getSize().x > 1.0f) {
+            view.zoom(0.5f);
+        }
+    }
+
+    void move(float dx, float dy) {
+        view.move(dx, dy);
+        fit_view();
+    }
+
+    // factor > 1 aleja la vista
+    void zoom(float factor) {
+        sf::View previous = view;
+        view.zoom(factor);
+        if (factor > 1.0f && graph.tiles_in(visible_area()).size() > graph.max_resident) {
+            view = previous;
+        }
+    }
+
+    void print_cache() const {
+        std::cout << "Teselas en memoria: " << graph.resident_count() << "/" << graph.max_resident << " ("
+                  << graph.resident_bytes() / 1024 << " KiB), leidas " << graph.stats.loads << ", descartadas "
+                  << graph.stats.evictions << ", aciertos " << graph.stats.hits << std::endl;
+    }
+
+    void draw() {
+        sf::RenderWindow &window = window_manager.get_window();
+        window.setView(view);
+
+        for (std::uint32_t t: graph.tiles_in(visible_area())) {
+            const Tile &tile = graph.tile(t);
+            if (tile.geometry.getVertexCount() == 0) continue;
+            window.draw(tile.geometry);
+            window_manager.record_draw(1, tile.geometry.getVertexCount());
+        }
+        if (route_geometry.getVertexCount() > 0) {
+            window.draw(route_geometry);
+            window_manager.record_draw(1, route_geometry.getVertexCount());
+        }
+        if (has_src) draw_marker(src_coord, sf::Color::Green);
+        if (has_dest) draw_marker(dest_coord, sf::Color::Cyan);
+    }
+
+    void draw_marker(sf::Vector2f coord, sf::Color color) {
+        sf::CircleShape point(3.0f);
+        point.setPosition(coord);
+        point.setFillColor(color);
+        window_manager.get_window().draw(point);
+        window_manager.record_draw(1, WindowManager::circle_vertices());
+    }
+
+    // mismo rectangulo que 'sfLine'
+    void append_line(sf::Vector2f p1, sf::Vector2f p2, sf::Color color, float thickness) {
+        sf::Vector2f direction = p2 - p1;
+        float length = std::sqrt(direction.x * direction.x + direction.y * direction.y);
+        if (length == 0.0f) return;
+        sf::Vector2f offset = (thickness / 2.f / length) * sf::Vector2f(-direction.y, direction.x);
+
+        route_geometry.append(sf::Vertex(p1 + offset, color));
+        route_geometry.append(sf::Vertex(p2 + offset, color));
+        route_geometry.append(sf::Vertex(p2 - offset, color));
+        route_geometry.append(sf::Vertex(p1 - offset, color));
+    }
+
+public:
+    // 'max_resident' es el limite de teselas en memoria (ver 'TiledGraph')
+    explicit TiledViewer(const std::string &tiles_path, std::size_t max_resident = 64,
+                         unsigned frame_rate_limit = 200) {
+        auto started = std::chrono::steady_clock::now();
+        if (!graph.open(tiles_path, max_resident)) {
+            std::cout << "No se pudo abrir " << tiles_path << " (crearlo con --build-tiles)" << std::endl;
+            window_manager.close();
+            return;
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+        std::cout << "Abierto " << tiles_path << ": " << graph.size() << " nodos en " << graph.tile_count()
+                  << " teselas (" << ms << " ms)" << std::endl;
+
+        // un pixel por unidad, como 'GUI', centrada en el grafo
+        sf::RenderWindow &window = window_manager.get_window();
+        sf::FloatRect bounds = graph.bounds();
+        view.setSize(sf::Vector2f(window.getSize()));
+        view.setCenter(bounds.left + bounds.width / 2.0f, bounds.top + bounds.height / 2.0f);
+        fit_view();
+        window.setFramerateLimit(frame_rate_limit);
+    }
+
+    void main_loop() {
+        while (window_manager.is_open()) {
+            sf::Event event{};
+            while (window_manager.poll_event(event)) {
+                switch (event.type) {
+                    case sf::Event::Closed: {
+                        window_manager.close();
+                        break;
+                    }
+
+                    case sf::Event::KeyPressed: {
+                        sf::Vector2f step = view.getSize() / 10.0f;
+                        switch (event.key.code) {
+                            case sf::Keyboard::Left: move(-step.x, 0.0f); break;
+                            case sf::Keyboard::Right: move(step.x, 0.0f); break;
+                            case sf::Keyboard::Up: move(0.0f, -step.y); break;
+                            case sf::Keyboard::Down: move(0.0f, step.y); break;
+                            case sf::Keyboard::Add:
+                            case sf::Keyboard::Equal: zoom(0.8f); break;
+                            case sf::Keyboard::Subtract:
+                            case sf::Keyboard::Hyphen: zoom(1.25f); break;
+                            case sf::Keyboard::D: run(false); break;
+                            case sf::Keyboard::A: run(true); break;
+                            case sf::Keyboard::R: reset(); break;
+                            case sf::Keyboard::I: print_cache(); break;
+                            case sf::Keyboard::Q: window_manager.close(); break;
+                            default: break;
+                        }
+                        break;
+                    }
+
+                    case sf::Event::MouseWheelScrolled: {
+                        zoom(event.mouseWheelScroll.delta > 0 ? 0.8f : 1.25f);
+                        break;
+                    }
+
+                    case sf::Event::MouseButtonPressed: {
+                        sf::RenderWindow &window = window_manager.get_window();
+                        sf::Vector2i mouse_position_screen = sf::Mouse::getPosition(window);
+                        select(window.mapPixelToCoords(mouse_position_screen, view));
+                        break;
+                    }
+
+                    default: {
+                        break;
+                    }
+                }
+            }
+
+            window_manager.clear();
+            draw();
+            window_manager.display();
+        }
+    }
+};
+
+
+#endif //HOMEWORK_GRAPH_TILED_VIEWER_H
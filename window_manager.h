@@ -6,14 +6,27 @@
 #define HOMEWORK_GRAPH_WINDOW_MANAGER_H
 
 #include <SFML/Graphics.hpp>
+#include <cstddef>
+
+
+// Costo de dibujo de un frame: llamadas a draw y vertices enviados a la GPU. SFML no los cuenta, asi que
+// cada funcion 'draw' del proyecto reporta los suyos con 'WindowManager::record_draw'.
+struct RenderCounters {
+    std::size_t draw_calls = 0;
+    std::size_t vertices = 0;
+};
+
 
 //*
 // ---- Window Manager ----
 // Esta clase sirve como wrapper de nuestra instancia de sf::RenderWindow
 // para realizar las manipulaciones de la instancia de manera segura.
+// Tambien acumula los 'RenderCounters' del frame en curso; 'display' los pasa a 'last_frame'.
 //*
 class WindowManager {
     sf::RenderWindow window;
+    RenderCounters current;
+    RenderCounters previous;
 
 public:
     explicit WindowManager(int window_width = 600, int window_height = 800) :
@@ -37,9 +50,25 @@ public:
     }
 
     void display() {
+        previous = current;
+        current = RenderCounters();
         window.display();
     }
 
+    void record_draw(std::size_t draw_calls, std::size_t vertices) {
+        current.draw_calls += draw_calls;
+        current.vertices += vertices;
+    }
+
+    const RenderCounters &last_frame() const {
+        return previous;
+    }
+
+    // vertices de un sf::CircleShape sin borde: abanico con el centro y el primer punto repetido
+    static std::size_t circle_vertices(std::size_t points = 30) {
+        return points + 2;
+    }
+
     sf::RenderWindow &get_window() {
         return window;
     }